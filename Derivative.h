@@ -0,0 +1,383 @@
+#pragma once
+
+#include <vector>
+#include <deque>
+#include <map>
+#include <cstring>
+#include <stdint.h>
+#include <math.h>
+#include "Expression.h"
+
+// A compiled expression as a tree, which can be differentiated symbolically with respect to x.
+// The nodes are stored in a vector and refer to their arguments by index, and a derivative refers to the
+// nodes of the expression it was made from, e.g. the derivative of sin(u) is cos(u)*u' with the same u.
+// Every node is simplified when it is made, so the derivatives don't fill up with terms like 0*x or x^1, and a
+// node that is already there is reused, so the same term made twice is one node.
+class SymbolicExpr
+{
+private:
+	struct Node
+	{
+		OpCode op;
+		double value; // The number of op_num nodes
+		int arg1;
+		int arg2; // -1 for functions, unary minus and leaves
+	};
+
+	// Nodes are the same if they have the same operation on the same arguments. Numbers are compared by their bits.
+	struct Key
+	{
+		OpCode op;
+		uint64_t bits;
+		int arg1;
+		int arg2;
+
+		bool operator<(const Key& other) const
+		{
+			if (op != other.op) return op < other.op;
+			if (bits != other.bits) return bits < other.bits;
+			if (arg1 != other.arg1) return arg1 < other.arg1;
+			return arg2 < other.arg2;
+		}
+	};
+
+	// What `emit` needs to know while it turns the nodes into a program.
+	struct Emission
+	{
+		std::vector<int> uses; // How many times each node is still going to be emitted
+		std::vector<int> temps; // The temporary each emitted node that is used again is stored in, or -1
+		std::vector<int> free_temps;
+		int num_temps;
+	};
+
+	std::vector<Node> nodes;
+	std::map<Key, int> index;
+	int root;
+
+	bool is_num(int node) const
+	{
+		return nodes[node].op == op_num;
+	}
+
+	bool is_num(int node, double value) const
+	{
+		return nodes[node].op == op_num && nodes[node].value == value;
+	}
+
+	static bool is_unary(OpCode op)
+	{
+		return op >= op_neg;
+	}
+
+	// Calculates the value of an operator with constant arguments, like `CompiledExpr` would.
+	static double fold(OpCode op, double a, double b)
+	{
+		switch (op)
+		{
+		case op_add: return a + b;
+		case op_sub: return a - b;
+		case op_mul: return a * b;
+		case op_div: return a / b;
+		case op_pow: return pow(a, b);
+		case op_neg: return -a;
+		case op_cos: return cos(a);
+		case op_sin: return sin(a);
+		case op_tan: return tan(a);
+		case op_sqrt: return sqrt(a);
+		case op_ln: return log(a);
+		case op_log: return log10(a);
+		default: return a;
+		}
+	}
+
+	int add_node(OpCode op, double value, int arg1, int arg2)
+	{
+		Key key = { op, 0, arg1, arg2 };
+		memcpy(&key.bits, &value, sizeof(double));
+
+		auto found = index.find(key);
+		if (found != index.end()) return found->second;
+
+		Node node = { op, value, arg1, arg2 };
+		nodes.push_back(node);
+		index[key] = (int)nodes.size() - 1;
+		return (int)nodes.size() - 1;
+	}
+
+	int num(double value)
+	{
+		return this->add_node(op_num, value, -1, -1);
+	}
+
+	// Makes a node with the simplifications that keep the value the same for all finite arguments.
+	int make(OpCode op, int a, int b = -1)
+	{
+		// Constant arguments are calculated right away
+		if (is_unary(op) && is_num(a)) return this->num(fold(op, nodes[a].value, 0.0));
+		if (!is_unary(op) && is_num(a) && is_num(b)) return this->num(fold(op, nodes[a].value, nodes[b].value));
+
+		switch (op)
+		{
+		case op_add:
+			if (is_num(a, 0)) return b;
+			if (is_num(b, 0)) return a;
+			if (nodes[b].op == op_neg) return this->make(op_sub, a, nodes[b].arg1);
+			break;
+
+		case op_sub:
+			if (is_num(b, 0)) return a;
+			if (is_num(a, 0)) return this->make(op_neg, b);
+			if (a == b) return this->num(0);
+			if (nodes[b].op == op_neg) return this->make(op_add, a, nodes[b].arg1);
+			break;
+
+		case op_mul:
+			if (is_num(a, 0) || is_num(b, 0)) return this->num(0);
+			if (is_num(a, 1)) return b;
+			if (is_num(b, 1)) return a;
+			if (is_num(a, -1)) return this->make(op_neg, b);
+			if (is_num(b, -1)) return this->make(op_neg, a);
+			// Constants are gathered in front, so 2*(3*x) becomes 6*x
+			if (is_num(b)) return this->make(op_mul, b, a);
+			if (is_num(a) && nodes[b].op == op_mul && is_num(nodes[b].arg1))
+				return this->make(op_mul, this->num(nodes[a].value * nodes[nodes[b].arg1].value), nodes[b].arg2);
+			break;
+
+		// 0/u and u/u are left as they are, since they aren't defined where u is 0
+		case op_div:
+			if (is_num(b, 1)) return a;
+			break;
+
+		case op_pow:
+			if (is_num(b, 0)) return this->num(1);
+			if (is_num(b, 1)) return a;
+			break;
+
+		case op_neg:
+			if (nodes[a].op == op_neg) return nodes[a].arg1;
+			break;
+
+		default:
+			break;
+		}
+
+		return this->add_node(op, 0.0, a, b);
+	}
+
+	// Makes the derivative of a node. The derivatives of the nodes are remembered in `derivs`, so a part of
+	// the expression that is used several times is only differentiated once.
+	int diff(int node, std::vector<int>& derivs)
+	{
+		if (derivs[node] >= 0) return derivs[node];
+
+		Node n = nodes[node];
+		int a = n.arg1, b = n.arg2;
+		int d = -1;
+
+		switch (n.op)
+		{
+		case op_num: d = this->num(0); break;
+		case op_x: d = this->num(1); break;
+		case op_y: d = this->num(0); break;
+
+		case op_add: d = this->make(op_add, this->diff(a, derivs), this->diff(b, derivs)); break;
+		case op_sub: d = this->make(op_sub, this->diff(a, derivs), this->diff(b, derivs)); break;
+		case op_neg: d = this->make(op_neg, this->diff(a, derivs)); break;
+
+		// (uv)' = u'v + uv'
+		case op_mul:
+			d = this->make(op_add,
+				this->make(op_mul, this->diff(a, derivs), b),
+				this->make(op_mul, a, this->diff(b, derivs)));
+			break;
+
+		// (u/v)' = (u'v - uv')/v^2
+		case op_div:
+		{
+			int db = this->diff(b, derivs);
+			if (is_num(db, 0))
+			{
+				d = this->make(op_div, this->diff(a, derivs), b);
+			}
+			else
+			{
+				d = this->make(op_div,
+					this->make(op_sub, this->make(op_mul, this->diff(a, derivs), b), this->make(op_mul, a, db)),
+					this->make(op_pow, b, this->num(2)));
+			}
+		}
+		break;
+
+		case op_pow:
+		{
+			int da = this->diff(a, derivs);
+			int db = this->diff(b, derivs);
+
+			if (is_num(db, 0))
+			{
+				// The power rule: (u^c)' = c*u^(c-1)*u'
+				int c_minus_1 = this->make(op_sub, b, this->num(1));
+				d = this->make(op_mul, this->make(op_mul, b, this->make(op_pow, a, c_minus_1)), da);
+			}
+			else
+			{
+				// (u^v)' = u^v*(v'*ln(u) + v*u'/u)
+				d = this->make(op_mul, node, this->make(op_add,
+					this->make(op_mul, db, this->make(op_ln, a)),
+					this->make(op_div, this->make(op_mul, b, da), a)));
+			}
+		}
+		break;
+
+		// The chain rule for the functions
+		case op_cos: d = this->make(op_mul, this->make(op_neg, this->make(op_sin, a)), this->diff(a, derivs)); break;
+		case op_sin: d = this->make(op_mul, this->make(op_cos, a), this->diff(a, derivs)); break;
+		case op_tan: d = this->make(op_div, this->diff(a, derivs), this->make(op_pow, this->make(op_cos, a), this->num(2))); break;
+		case op_sqrt: d = this->make(op_div, this->diff(a, derivs), this->make(op_mul, this->num(2), node)); break;
+		case op_ln: d = this->make(op_div, this->diff(a, derivs), a); break;
+		case op_log: d = this->make(op_div, this->diff(a, derivs), this->make(op_mul, this->num(M_LN10), a)); break;
+		default: break; // Temporaries are never nodes
+		}
+
+		derivs[node] = d;
+		return d;
+	}
+
+	// Counts how many times every node below `node` is used. The arguments of a node are only counted the
+	// first time it is reached, since it is only computed once.
+	void count_uses(int node, std::vector<int>& uses) const
+	{
+		if (uses[node]++ > 0) return;
+
+		const Node& n = nodes[node];
+		if (n.arg1 >= 0) this->count_uses(n.arg1, uses);
+		if (n.arg2 >= 0) this->count_uses(n.arg2, uses);
+	}
+
+	// Emits a node in postfix order. A node that is used more than once is computed the first time and kept
+	// in a temporary, which the later uses load, so the program has one computation for every node. A
+	// temporary is given to another node after the last use of the one in it.
+	void emit(int node, CompiledExpr& expr, size_t& depth, Emission& emission) const
+	{
+		const Node& n = nodes[node];
+		int& temp = emission.temps[node];
+		int remaining = --emission.uses[node];
+
+		if (temp >= 0)
+		{
+			expr.emit(op_load, temp, depth);
+			if (remaining == 0) emission.free_temps.push_back(temp);
+			return;
+		}
+
+		if (n.arg1 >= 0) this->emit(n.arg1, expr, depth, emission);
+		if (n.arg2 >= 0) this->emit(n.arg2, expr, depth, emission);
+		expr.emit(n.op, n.value, depth);
+
+		// Leaves are as cheap to push again as to load
+		if (remaining > 0 && n.op > op_y)
+		{
+			if (emission.free_temps.empty())
+			{
+				temp = emission.num_temps++;
+			}
+			else
+			{
+				temp = emission.free_temps.back();
+				emission.free_temps.pop_back();
+			}
+			expr.emit(op_store, temp, depth);
+		}
+	}
+
+public:
+	// Rebuilds the tree of a compiled expression from its postfix program.
+	SymbolicExpr(const CompiledExpr& expr)
+	{
+		std::vector<int> stack;
+		std::vector<int> temps(expr.num_temps);
+
+		for (const Instruction& instr : expr.program)
+		{
+			// A temporary stands for the node that was stored in it
+			if (instr.op == op_store)
+			{
+				temps[(size_t)instr.value] = stack.back();
+			}
+			else if (instr.op == op_load)
+			{
+				stack.push_back(temps[(size_t)instr.value]);
+			}
+			else if (instr.op <= op_y)
+			{
+				stack.push_back(this->add_node(instr.op, instr.value, -1, -1));
+			}
+			else if (is_unary(instr.op))
+			{
+				stack.back() = this->add_node(instr.op, 0.0, stack.back(), -1);
+			}
+			else
+			{
+				int b = stack.back();
+				stack.pop_back();
+				stack.back() = this->add_node(instr.op, 0.0, stack.back(), b);
+			}
+		}
+
+		root = stack.back();
+	}
+
+	// The derivative with respect to x. The t of parametric curves and the theta of polar curves are
+	// compiled as x, so this is also the derivative with respect to those.
+	SymbolicExpr derivative() const
+	{
+		SymbolicExpr result = *this;
+		std::vector<int> derivs(nodes.size(), -1);
+		result.root = result.diff(root, derivs);
+		return result;
+	}
+
+	// Compiles the expression for the same evaluation as any other `CompiledExpr`.
+	CompiledExpr compile() const
+	{
+		Emission emission;
+		emission.uses.assign(nodes.size(), 0);
+		emission.temps.assign(nodes.size(), -1);
+		emission.num_temps = 0;
+		this->count_uses(root, emission.uses);
+
+		CompiledExpr expr;
+		size_t depth = 0;
+		this->emit(root, expr, depth, emission);
+		return expr;
+	}
+};
+
+// An expression and its derivatives, which are made the first time they are asked for and then kept.
+// Plotting f, f' and f'' thus only parses f once and differentiates it twice.
+class DerivativeChain
+{
+private:
+	// A deque keeps the references that `get` returns valid when more derivatives are added.
+	std::deque<SymbolicExpr> symbolic;
+	std::deque<CompiledExpr> compiled;
+
+public:
+	DerivativeChain(const CompiledExpr& expr)
+	{
+		symbolic.push_back(SymbolicExpr(expr));
+		compiled.push_back(expr);
+	}
+
+	// The derivative of the given order, where order 0 is the expression itself.
+	const CompiledExpr& get(size_t order)
+	{
+		while (compiled.size() <= order)
+		{
+			symbolic.push_back(symbolic.back().derivative());
+			compiled.push_back(symbolic.back().compile());
+		}
+
+		return compiled[order];
+	}
+};
@@ -0,0 +1,568 @@
+#pragma once
+
+#include <string>
+#include <sstream>
+#include <vector>
+#include <map>
+#include <algorithm>
+#include <exception>
+#include <math.h>
+#include "Parser.h"
+#include "Interval.h"
+
+// Instructions of a compiled expression. The program runs on a stack, so every instruction either
+// pushes a value or replaces the values on top of the stack with its result.
+enum OpCode {
+	op_num,		// Push a constant number
+	op_x,		// Push the variable x
+	op_y,		// Push the variable y
+	op_load,	// Push the temporary with the number value
+	op_add,		// +
+	op_sub,		// -
+	op_mul,		// *
+	op_div,		// /
+	op_pow,		// ^
+	op_neg,		// Unary minus
+	op_cos,
+	op_sin,
+	op_tan,
+	op_sqrt,
+	op_ln,
+	op_log,
+	op_store,	// Copy the top of the stack to the temporary with the number value, and leave it there
+};
+
+struct Instruction {
+	OpCode op;
+	double value;
+};
+
+// The position in a program of a number that comes from a defined name, so it can be changed in place.
+struct Binding {
+	size_t index;
+	std::string name;
+};
+
+// A name the user has defined, either as a number like a = 2 or as a function of x like g(x) = a*sin(x).
+// A function is kept as the program of its body, and is compiled into the expressions that use it.
+struct Symbol {
+	bool is_function;
+	double value;
+	std::vector<Instruction> program;
+	std::vector<Binding> bindings; // The defined numbers in the program of a function
+};
+
+typedef std::map<std::string, Symbol> SymbolMap;
+
+// An expression in x and y that is parsed once and can then be evaluated for many values of the
+// variables, without going through the tokens and strings again like `Evaluator` does.
+class CompiledExpr
+{
+private:
+	// Build new programs from the ones of compiled expressions, e.g. their derivatives or the bodies of functions,
+	// or read them into a graph of operations shared between expressions.
+	friend class SymbolicExpr;
+	friend class SymbolTable;
+	friend class ExpressionDag;
+
+	std::vector<Instruction> program;
+	std::vector<Binding> bindings; // Sorted by index
+	size_t stack_size = 0;
+	size_t num_temps = 0; // Temporaries hold values that are used several times, in programs `SymbolicExpr` emits
+
+	// An empty program, which `SymbolicExpr` emits into.
+	CompiledExpr() {}
+
+	// Number of values that `eval_batch` pushes through every instruction at once.
+	static const size_t batch_size = 256;
+
+	static bool is_prefix(OpCode op)
+	{
+		return op >= op_neg;
+	}
+
+	static OpCode function_op(const std::string& name)
+	{
+		switch (str_to_int(name.c_str()))
+		{
+		case str_to_int("cos"): return op_cos;
+		case str_to_int("sin"): return op_sin;
+		case str_to_int("tan"): return op_tan;
+		case str_to_int("sqrt"): return op_sqrt;
+		// log as defined by math.h is the natural logarithm. We will stick to log being log10.
+		case str_to_int("ln"): return op_ln;
+		case str_to_int("log"): return op_log;
+		default: throw InvalidFunction();
+		}
+	}
+
+	// Appends an instruction to the program and keeps track of how deep the stack gets.
+	void emit(OpCode op, double value, size_t& depth)
+	{
+		if ((op == op_load || op == op_store) && value >= num_temps) num_temps = (size_t)value + 1;
+
+		if (op <= op_load)
+		{
+			depth++;
+		}
+		else if (!is_prefix(op))
+		{
+			if (depth < 2) throw MisplacedOperator();
+			depth--;
+		}
+		else if (depth < 1)
+		{
+			throw MisplacedOperator();
+		}
+
+		if (depth > stack_size) stack_size = depth;
+
+		Instruction instr = { op, value };
+		program.push_back(instr);
+	}
+
+	// Converts the expression tree to a postfix program: the arguments of a node are emitted before the node itself.
+	void emit_tree(const InfixTree* node, size_t& depth, const SymbolMap* symbols)
+	{
+		switch (node->op->type)
+		{
+		case TokenKind::num:
+			this->emit(op_num, node->num, depth);
+			break;
+
+		case TokenKind::variable:
+			// A name that is defined as a number is replaced by the number
+			if (symbols != NULL && symbols->count(node->op->value))
+			{
+				Binding binding = { program.size(), node->op->value };
+				bindings.push_back(binding);
+				this->emit(op_num, symbols->at(node->op->value).value, depth);
+				break;
+			}
+
+			// The parameter t of a parametric curve and the angle theta of a polar curve are passed as
+			// the first variable, just like x.
+			this->emit(node->op->value == "y" ? op_y : op_x, 0.0, depth);
+			break;
+
+		case TokenKind::function:
+			// A function the user has defined is compiled in place, with its argument wherever its body has x
+			// The numbers it uses stay bound to their names.
+			if (symbols != NULL && symbols->count(node->op->value))
+			{
+				const Symbol& symbol = symbols->at(node->op->value);
+				size_t next = 0;
+				for (size_t i = 0; i < symbol.program.size(); i++)
+				{
+					const Instruction& instr = symbol.program[i];
+					if (instr.op == op_x)
+					{
+						this->emit_tree(node->arg2, depth, symbols);
+						continue;
+					}
+
+					if (next < symbol.bindings.size() && symbol.bindings[next].index == i)
+					{
+						Binding binding = { program.size(), symbol.bindings[next].name };
+						bindings.push_back(binding);
+						next++;
+					}
+					this->emit(instr.op, instr.value, depth);
+				}
+				break;
+			}
+
+			this->emit_tree(node->arg2, depth, symbols);
+			this->emit(function_op(node->op->value), 0.0, depth);
+			break;
+
+		case TokenKind::add_op:
+		case TokenKind::sub_op:
+		case TokenKind::mul_op:
+		case TokenKind::div_op:
+		case TokenKind::pow_op:
+		{
+			// A minus without a left argument negates its argument
+			if (node->arg1 == NULL)
+			{
+				this->emit_tree(node->arg2, depth, symbols);
+				this->emit(op_neg, 0.0, depth);
+				break;
+			}
+
+			OpCode op = node->op->type == TokenKind::add_op ? op_add
+				: node->op->type == TokenKind::sub_op ? op_sub
+				: node->op->type == TokenKind::mul_op ? op_mul
+				: node->op->type == TokenKind::div_op ? op_div
+				: op_pow;
+
+			this->emit_tree(node->arg1, depth, symbols);
+			this->emit_tree(node->arg2, depth, symbols);
+			this->emit(op, 0.0, depth);
+		}
+		break;
+
+		// Vectors and matrices can't be part of a plotted expression
+		default:
+			throw UnsuccesfulCalculation();
+			break;
+		}
+	}
+
+	// Parses the tokens into a tree with `InfixParser`, so plotted expressions follow exactly the same
+	// rules as the ones that are calculated right away.
+	void compile(std::vector<Token>& tokens, const SymbolMap* symbols)
+	{
+		// A name that is defined as a number is a leaf of the tree, like a variable, and not a function
+		if (symbols != NULL)
+		{
+			for (Token& tok : tokens)
+			{
+				auto symbol = symbols->find(tok.value);
+				if (tok.type == TokenKind::function && symbol != symbols->end() && !symbol->second.is_function)
+				{
+					tok.type = TokenKind::variable;
+				}
+			}
+		}
+
+		ParseArena arena(InfixParser::arena_size(tokens.size()));
+		InfixParser parser(tokens, arena);
+		size_t depth = 0;
+
+		// Every token gives at most one instruction
+		program.reserve(tokens.size());
+		this->emit_tree(parser.parse(), depth, symbols);
+
+		// If everything went according to plan, the program leaves exactly 1 value on the stack.
+		if (depth != 1) throw UnsuccesfulCalculation();
+	}
+
+	// Runs one instruction on `count` values at once. `top` points to the values on top of the stack, and
+	// temporary k is at temps + k*batch_size.
+	static void run_batch(const Instruction& instr, double* top, double* temps, const double* xs, const double* ys, size_t count)
+	{
+		const double* arg = top;
+		double* res = top - batch_size; // Binary operators store their result in place of the left argument
+
+		switch (instr.op)
+		{
+		case op_num: for (size_t j = 0; j < count; j++) top[j + batch_size] = instr.value; break;
+		case op_x: for (size_t j = 0; j < count; j++) top[j + batch_size] = xs[j]; break;
+		case op_y: for (size_t j = 0; j < count; j++) top[j + batch_size] = ys[j]; break;
+		case op_load: std::copy(temps + (size_t)instr.value * batch_size, temps + (size_t)instr.value * batch_size + count, top + batch_size); break;
+		case op_store: std::copy(top, top + count, temps + (size_t)instr.value * batch_size); break;
+		case op_add: for (size_t j = 0; j < count; j++) res[j] += arg[j]; break;
+		case op_sub: for (size_t j = 0; j < count; j++) res[j] -= arg[j]; break;
+		case op_mul: for (size_t j = 0; j < count; j++) res[j] *= arg[j]; break;
+		case op_div: for (size_t j = 0; j < count; j++) res[j] /= arg[j]; break;
+		case op_pow: for (size_t j = 0; j < count; j++) res[j] = pow(res[j], arg[j]); break;
+		case op_neg: for (size_t j = 0; j < count; j++) top[j] = -top[j]; break;
+		case op_cos: for (size_t j = 0; j < count; j++) top[j] = cos(top[j]); break;
+		case op_sin: for (size_t j = 0; j < count; j++) top[j] = sin(top[j]); break;
+		case op_tan: for (size_t j = 0; j < count; j++) top[j] = tan(top[j]); break;
+		case op_sqrt: for (size_t j = 0; j < count; j++) top[j] = sqrt(top[j]); break;
+		case op_ln: for (size_t j = 0; j < count; j++) top[j] = log(top[j]); break;
+		case op_log: for (size_t j = 0; j < count; j++) top[j] = log10(top[j]); break;
+		}
+	}
+
+	// The derivative of a^b, where a and b have the derivatives da and db and p = a^b.
+	// Each term is only included when its derivative isn't 0, so e.g. (-2)^2 still gets a derivative even
+	// though ln(-2) isn't defined.
+	static double pow_derivative(double a, double da, double b, double db, double p)
+	{
+		double d = 0.0;
+		if (da != 0) d += b * pow(a, b - 1) * da;
+		if (db != 0) d += p * log(a) * db;
+		return d;
+	}
+
+	// Like `run_batch`, but every value comes with its derivative with respect to x, which is stored at the
+	// same place in `dtop` as the value is in `top`. The derivatives follow the chain rule, so they are exact
+	// and not approximated by differences.
+	static void run_batch_dual(const Instruction& instr, double* top, double* dtop, double* temps, double* dtemps, const double* xs, const double* ys, size_t count)
+	{
+		const double* arg = top;
+		const double* darg = dtop;
+		double* res = top - batch_size;
+		double* dres = dtop - batch_size;
+
+		switch (instr.op)
+		{
+		case op_num: for (size_t j = 0; j < count; j++) { top[j + batch_size] = instr.value; dtop[j + batch_size] = 0.0; } break;
+		case op_x: for (size_t j = 0; j < count; j++) { top[j + batch_size] = xs[j]; dtop[j + batch_size] = 1.0; } break;
+		case op_y: for (size_t j = 0; j < count; j++) { top[j + batch_size] = ys[j]; dtop[j + batch_size] = 0.0; } break;
+		case op_load:
+		{
+			size_t k = (size_t)instr.value * batch_size;
+			std::copy(temps + k, temps + k + count, top + batch_size);
+			std::copy(dtemps + k, dtemps + k + count, dtop + batch_size);
+		}
+		break;
+		case op_store:
+		{
+			size_t k = (size_t)instr.value * batch_size;
+			std::copy(top, top + count, temps + k);
+			std::copy(dtop, dtop + count, dtemps + k);
+		}
+		break;
+		case op_add: for (size_t j = 0; j < count; j++) { res[j] += arg[j]; dres[j] += darg[j]; } break;
+		case op_sub: for (size_t j = 0; j < count; j++) { res[j] -= arg[j]; dres[j] -= darg[j]; } break;
+		case op_mul: for (size_t j = 0; j < count; j++) { dres[j] = dres[j] * arg[j] + res[j] * darg[j]; res[j] *= arg[j]; } break;
+		case op_div: for (size_t j = 0; j < count; j++) { dres[j] = (dres[j] * arg[j] - res[j] * darg[j]) / (arg[j] * arg[j]); res[j] /= arg[j]; } break;
+		case op_pow:
+			for (size_t j = 0; j < count; j++)
+			{
+				double p = pow(res[j], arg[j]);
+				dres[j] = pow_derivative(res[j], dres[j], arg[j], darg[j], p);
+				res[j] = p;
+			}
+			break;
+		case op_neg: for (size_t j = 0; j < count; j++) { top[j] = -top[j]; dtop[j] = -dtop[j]; } break;
+		case op_cos: for (size_t j = 0; j < count; j++) { dtop[j] *= -sin(top[j]); top[j] = cos(top[j]); } break;
+		case op_sin: for (size_t j = 0; j < count; j++) { dtop[j] *= cos(top[j]); top[j] = sin(top[j]); } break;
+		case op_tan: for (size_t j = 0; j < count; j++) { top[j] = tan(top[j]); dtop[j] *= 1 + top[j] * top[j]; } break;
+		case op_sqrt: for (size_t j = 0; j < count; j++) { top[j] = sqrt(top[j]); dtop[j] /= 2 * top[j]; } break;
+		case op_ln: for (size_t j = 0; j < count; j++) { dtop[j] /= top[j]; top[j] = log(top[j]); } break;
+		case op_log: for (size_t j = 0; j < count; j++) { dtop[j] /= top[j] * M_LN10; top[j] = log10(top[j]); } break;
+		}
+	}
+
+public:
+	// The expression can use the names defined in symbols, if it is given.
+	CompiledExpr(std::string input, const SymbolMap* symbols = NULL)
+	{
+		Tokenizer tokenizer(input);
+		std::vector<Token> tokens = tokenizer.tokenize();
+
+		this->compile(tokens, symbols);
+	}
+
+	// Changes the value of a defined number everywhere the expression uses it, also inside the defined
+	// functions it uses, without compiling it again. Returns whether it uses the number at all.
+	bool bind(const std::string& name, double value)
+	{
+		bool used = false;
+		for (const Binding& binding : bindings)
+		{
+			if (binding.name != name) continue;
+			program[binding.index].value = value;
+			used = true;
+		}
+
+		return used;
+	}
+
+	// Evaluates the expression for a single point.
+	double eval(double x, double y = 0.0) const
+	{
+		double small_stack[32];
+		std::vector<double> big_stack;
+		double* stack = small_stack;
+		if (stack_size > 32)
+		{
+			big_stack.resize(stack_size);
+			stack = big_stack.data();
+		}
+		std::vector<double> temps(num_temps);
+
+		size_t sp = 0;
+
+		for (const Instruction& instr : program)
+		{
+			switch (instr.op)
+			{
+			case op_num: stack[sp++] = instr.value; break;
+			case op_x: stack[sp++] = x; break;
+			case op_y: stack[sp++] = y; break;
+			case op_load: stack[sp++] = temps[(size_t)instr.value]; break;
+			case op_store: temps[(size_t)instr.value] = stack[sp - 1]; break;
+			case op_add: sp--; stack[sp - 1] += stack[sp]; break;
+			case op_sub: sp--; stack[sp - 1] -= stack[sp]; break;
+			case op_mul: sp--; stack[sp - 1] *= stack[sp]; break;
+			case op_div: sp--; stack[sp - 1] /= stack[sp]; break;
+			case op_pow: sp--; stack[sp - 1] = pow(stack[sp - 1], stack[sp]); break;
+			case op_neg: stack[sp - 1] = -stack[sp - 1]; break;
+			case op_cos: stack[sp - 1] = cos(stack[sp - 1]); break;
+			case op_sin: stack[sp - 1] = sin(stack[sp - 1]); break;
+			case op_tan: stack[sp - 1] = tan(stack[sp - 1]); break;
+			case op_sqrt: stack[sp - 1] = sqrt(stack[sp - 1]); break;
+			case op_ln: stack[sp - 1] = log(stack[sp - 1]); break;
+			case op_log: stack[sp - 1] = log10(stack[sp - 1]); break;
+			}
+		}
+
+		return stack[0];
+	}
+
+	// Bounds the values of the expression when x and y range over intervals, with interval arithmetic.
+	// The bounds can be wider than the actual values, in particular when a variable occurs several times.
+	Interval eval_interval(Interval x, Interval y = Interval(0)) const
+	{
+		Interval small_stack[32];
+		std::vector<Interval> big_stack;
+		Interval* stack = small_stack;
+		if (stack_size > 32)
+		{
+			big_stack.resize(stack_size);
+			stack = big_stack.data();
+		}
+		std::vector<Interval> temps(num_temps);
+
+		size_t sp = 0;
+
+		for (const Instruction& instr : program)
+		{
+			switch (instr.op)
+			{
+			case op_num: stack[sp++] = Interval(instr.value); break;
+			case op_x: stack[sp++] = x; break;
+			case op_y: stack[sp++] = y; break;
+			case op_load: stack[sp++] = temps[(size_t)instr.value]; break;
+			case op_store: temps[(size_t)instr.value] = stack[sp - 1]; break;
+			case op_add: sp--; stack[sp - 1] = stack[sp - 1] + stack[sp]; break;
+			case op_sub: sp--; stack[sp - 1] = stack[sp - 1] - stack[sp]; break;
+			case op_mul: sp--; stack[sp - 1] = stack[sp - 1] * stack[sp]; break;
+			case op_div: sp--; stack[sp - 1] = stack[sp - 1] / stack[sp]; break;
+			case op_pow: sp--; stack[sp - 1] = pow(stack[sp - 1], stack[sp]); break;
+			case op_neg: stack[sp - 1] = -stack[sp - 1]; break;
+			case op_cos: stack[sp - 1] = cos(stack[sp - 1]); break;
+			case op_sin: stack[sp - 1] = sin(stack[sp - 1]); break;
+			case op_tan: stack[sp - 1] = tan(stack[sp - 1]); break;
+			case op_sqrt: stack[sp - 1] = sqrt(stack[sp - 1]); break;
+			case op_ln: stack[sp - 1] = log(stack[sp - 1]); break;
+			case op_log: stack[sp - 1] = log10(stack[sp - 1]); break;
+			}
+		}
+
+		return stack[0];
+	}
+
+	// Evaluates the expression and its derivative with respect to x for a single point, in one pass with
+	// forward-mode automatic differentiation. Every value on the stack carries its derivative along with it.
+	double eval_derivative(double x, double y, double& derivative) const
+	{
+		double small_stack[32], small_dstack[32];
+		std::vector<double> big_stack, big_dstack;
+		double* stack = small_stack;
+		double* dstack = small_dstack;
+		if (stack_size > 32)
+		{
+			big_stack.resize(stack_size);
+			big_dstack.resize(stack_size);
+			stack = big_stack.data();
+			dstack = big_dstack.data();
+		}
+		std::vector<double> temps(num_temps), dtemps(num_temps);
+
+		size_t sp = 0;
+
+		for (const Instruction& instr : program)
+		{
+			// The top of the stack is at a[-1] and its derivative at da[-1], and the value below it at a[-2].
+			double* a = stack + sp;
+			double* da = dstack + sp;
+
+			switch (instr.op)
+			{
+			case op_num: a[0] = instr.value; da[0] = 0.0; sp++; break;
+			case op_x: a[0] = x; da[0] = 1.0; sp++; break;
+			case op_y: a[0] = y; da[0] = 0.0; sp++; break;
+			case op_load: a[0] = temps[(size_t)instr.value]; da[0] = dtemps[(size_t)instr.value]; sp++; break;
+			case op_store: temps[(size_t)instr.value] = a[-1]; dtemps[(size_t)instr.value] = da[-1]; break;
+			case op_add: a[-2] += a[-1]; da[-2] += da[-1]; sp--; break;
+			case op_sub: a[-2] -= a[-1]; da[-2] -= da[-1]; sp--; break;
+			case op_mul: da[-2] = da[-2] * a[-1] + a[-2] * da[-1]; a[-2] *= a[-1]; sp--; break;
+			case op_div: da[-2] = (da[-2] * a[-1] - a[-2] * da[-1]) / (a[-1] * a[-1]); a[-2] /= a[-1]; sp--; break;
+			case op_pow:
+			{
+				double p = pow(a[-2], a[-1]);
+				da[-2] = pow_derivative(a[-2], da[-2], a[-1], da[-1], p);
+				a[-2] = p;
+				sp--;
+			}
+			break;
+			case op_neg: a[-1] = -a[-1]; da[-1] = -da[-1]; break;
+			case op_cos: da[-1] *= -sin(a[-1]); a[-1] = cos(a[-1]); break;
+			case op_sin: da[-1] *= cos(a[-1]); a[-1] = sin(a[-1]); break;
+			case op_tan: a[-1] = tan(a[-1]); da[-1] *= 1 + a[-1] * a[-1]; break;
+			case op_sqrt: a[-1] = sqrt(a[-1]); da[-1] /= 2 * a[-1]; break;
+			case op_ln: da[-1] /= a[-1]; a[-1] = log(a[-1]); break;
+			case op_log: da[-1] /= a[-1] * M_LN10; a[-1] = log10(a[-1]); break;
+			}
+		}
+
+		derivative = dstack[0];
+		return stack[0];
+	}
+
+	// Evaluates the expression for n points (xs[i], ys[i]) and writes the results to out.
+	// Every instruction is run on a whole batch of points before moving on to the next one, so the
+	// instructions are only decoded once per batch and the simple loops can be vectorized.
+	// It is safe to call this from several threads at once.
+	void eval_batch(const double* xs, const double* ys, double* out, size_t n) const
+	{
+		// One slot of batch_size values per stack level, plus one below the bottom so `run_batch`
+		// can always address the slot above the current top.
+		std::vector<double> stack((stack_size + 1) * batch_size);
+		std::vector<double> temps(num_temps * batch_size);
+
+		for (size_t begin = 0; begin < n; begin += batch_size)
+		{
+			size_t count = n - begin < batch_size ? n - begin : batch_size;
+			double* top = stack.data();
+
+			for (const Instruction& instr : program)
+			{
+				run_batch(instr, top, temps.data(), xs + begin, ys + begin, count);
+
+				if (instr.op <= op_load) top += batch_size;
+				else if (!is_prefix(instr.op)) top -= batch_size;
+			}
+
+			for (size_t j = 0; j < count; j++)
+			{
+				out[begin + j] = top[j];
+			}
+		}
+	}
+
+	// Like `eval_batch`, but also writes the derivatives with respect to x to derivatives. Both come out of
+	// the same pass over the program, so this costs only a few more operations per instruction.
+	void eval_batch_derivative(const double* xs, const double* ys, double* out, double* derivatives, size_t n) const
+	{
+		std::vector<double> stack((stack_size + 1) * batch_size);
+		std::vector<double> dstack((stack_size + 1) * batch_size);
+		std::vector<double> temps(num_temps * batch_size), dtemps(num_temps * batch_size);
+
+		for (size_t begin = 0; begin < n; begin += batch_size)
+		{
+			size_t count = n - begin < batch_size ? n - begin : batch_size;
+			double* top = stack.data();
+			double* dtop = dstack.data();
+
+			for (const Instruction& instr : program)
+			{
+				run_batch_dual(instr, top, dtop, temps.data(), dtemps.data(), xs + begin, ys + begin, count);
+
+				if (instr.op <= op_load)
+				{
+					top += batch_size;
+					dtop += batch_size;
+				}
+				else if (!is_prefix(instr.op))
+				{
+					top -= batch_size;
+					dtop -= batch_size;
+				}
+			}
+
+			for (size_t j = 0; j < count; j++)
+			{
+				out[begin + j] = top[j];
+				derivatives[begin + j] = dtop[j];
+			}
+		}
+	}
+};
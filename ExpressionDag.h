@@ -0,0 +1,239 @@
+#pragma once
+
+#include <vector>
+#include <map>
+#include <cstring>
+#include <stdint.h>
+#include <math.h>
+#include "Expression.h"
+
+// The expressions of several graphs that are sampled at the same x-values, as one graph of operations where
+// every distinct subexpression is a single node. sin(x), sin(x)^2 and 2*sin(x)+cos(x) thus share the node
+// of sin(x). Every node keeps its values at all the x-values, so adding an expression only evaluates the
+// nodes that weren't there before.
+class ExpressionDag
+{
+private:
+	struct Node
+	{
+		OpCode op;
+		double value; // The number of op_num nodes
+		int arg1;
+		int arg2; // -1 for functions, unary minus and leaves
+	};
+
+	// Nodes are the same if they have the same operation on the same arguments. Numbers are compared by their
+	// bits, so the node of a NaN is found again.
+	struct Key
+	{
+		OpCode op;
+		uint64_t bits;
+		int arg1;
+		int arg2;
+
+		bool operator<(const Key& other) const
+		{
+			if (op != other.op) return op < other.op;
+			if (bits != other.bits) return bits < other.bits;
+			if (arg1 != other.arg1) return arg1 < other.arg1;
+			return arg2 < other.arg2;
+		}
+	};
+
+	std::vector<double> xs;
+	std::vector<Node> nodes; // Every node comes after its arguments
+	std::map<Key, int> index;
+	std::vector<std::vector<double>> values; // Of the nodes that have been evaluated, which come first
+
+	static bool is_unary(OpCode op)
+	{
+		return op >= op_neg;
+	}
+
+	static bool is_commutative(OpCode op)
+	{
+		return op == op_add || op == op_mul;
+	}
+
+	// The node for an operation, which is only made if there isn't one already and `add` is true. Returns -1
+	// if it isn't there.
+	int find_or_add(OpCode op, double value, int arg1, int arg2, bool add = true)
+	{
+		// a+b is the same node as b+a
+		if (is_commutative(op) && arg2 < arg1) std::swap(arg1, arg2);
+
+		Key key = { op, 0, arg1, arg2 };
+		memcpy(&key.bits, &value, sizeof(double));
+
+		auto found = index.find(key);
+		if (found != index.end()) return found->second;
+		if (!add) return -1;
+
+		Node node = { op, value, arg1, arg2 };
+		nodes.push_back(node);
+		index[key] = (int)nodes.size() - 1;
+		return (int)nodes.size() - 1;
+	}
+
+	// Calculates the values of every node that hasn't been evaluated yet, from those of its arguments.
+	void evaluate()
+	{
+		size_t n = xs.size();
+
+		for (size_t i = values.size(); i < nodes.size(); i++)
+		{
+			const Node& node = nodes[i];
+			std::vector<double> out(n);
+			const double* a = node.arg1 >= 0 ? values[node.arg1].data() : NULL;
+			const double* b = node.arg2 >= 0 ? values[node.arg2].data() : NULL;
+
+			switch (node.op)
+			{
+			case op_num: for (size_t j = 0; j < n; j++) out[j] = node.value; break;
+			case op_x: for (size_t j = 0; j < n; j++) out[j] = xs[j]; break;
+			case op_y: break; // A graph of x has y = 0
+			case op_add: for (size_t j = 0; j < n; j++) out[j] = a[j] + b[j]; break;
+			case op_sub: for (size_t j = 0; j < n; j++) out[j] = a[j] - b[j]; break;
+			case op_mul: for (size_t j = 0; j < n; j++) out[j] = a[j] * b[j]; break;
+			case op_div: for (size_t j = 0; j < n; j++) out[j] = a[j] / b[j]; break;
+			case op_pow: for (size_t j = 0; j < n; j++) out[j] = pow(a[j], b[j]); break;
+			case op_neg: for (size_t j = 0; j < n; j++) out[j] = -a[j]; break;
+			case op_cos: for (size_t j = 0; j < n; j++) out[j] = cos(a[j]); break;
+			case op_sin: for (size_t j = 0; j < n; j++) out[j] = sin(a[j]); break;
+			case op_tan: for (size_t j = 0; j < n; j++) out[j] = tan(a[j]); break;
+			case op_sqrt: for (size_t j = 0; j < n; j++) out[j] = sqrt(a[j]); break;
+			case op_ln: for (size_t j = 0; j < n; j++) out[j] = log(a[j]); break;
+			case op_log: for (size_t j = 0; j < n; j++) out[j] = log10(a[j]); break;
+			default: break; // Temporaries are never nodes
+			}
+
+			values.push_back(std::vector<double>());
+			values.back().swap(out);
+		}
+	}
+
+	// The node of an expression, where `add` is true if the nodes that aren't there yet are made. Returns -1 if
+	// they aren't.
+	int node_of(const CompiledExpr& expr, bool add)
+	{
+		std::vector<int> stack;
+		std::vector<int> temps(expr.num_temps);
+
+		for (const Instruction& instr : expr.program)
+		{
+			// A temporary stands for the node that was stored in it
+			if (instr.op == op_store)
+			{
+				temps[(size_t)instr.value] = stack.back();
+			}
+			else if (instr.op == op_load)
+			{
+				stack.push_back(temps[(size_t)instr.value]);
+			}
+			else if (instr.op <= op_y)
+			{
+				stack.push_back(this->find_or_add(instr.op, instr.op == op_num ? instr.value : 0.0, -1, -1, add));
+			}
+			else if (is_unary(instr.op))
+			{
+				stack.back() = this->find_or_add(instr.op, 0.0, stack.back(), -1, add);
+			}
+			else
+			{
+				int b = stack.back();
+				stack.pop_back();
+				stack.back() = this->find_or_add(instr.op, 0.0, stack.back(), b, add);
+			}
+
+			if (stack.back() < 0) return -1;
+		}
+
+		return stack.back();
+	}
+
+public:
+	ExpressionDag(const std::vector<double>& _xs)
+		: xs(_xs)
+	{
+	}
+
+	// The x-values every expression is evaluated at.
+	const std::vector<double>& grid() const
+	{
+		return xs;
+	}
+
+	// The number of distinct nodes of all the expressions.
+	size_t size() const
+	{
+		return nodes.size();
+	}
+
+	// Adds an expression and returns its node. Subexpressions that are already there are reused.
+	int add(const CompiledExpr& expr)
+	{
+		return this->node_of(expr, true);
+	}
+
+	// The node of an expression whose nodes are all there already, like those of the graphs that have been
+	// drawn, or -1 if it isn't.
+	int find(const CompiledExpr& expr)
+	{
+		return this->node_of(expr, false);
+	}
+
+	// The values of a node at every x-value. Only the nodes that were added since the last time are evaluated.
+	// The reference is valid until the next call to `add` or `compact`.
+	const std::vector<double>& values_of(int node)
+	{
+		this->evaluate();
+		return values[node];
+	}
+
+	// Removes every node that none of the given roots use, keeping the values of the rest, and returns the
+	// new indices of the roots.
+	std::vector<int> compact(const std::vector<int>& roots)
+	{
+		// The arguments of a node come before it, so going backwards reaches every node after all that use it
+		std::vector<bool> used(nodes.size(), false);
+		for (int root : roots) used[root] = true;
+		for (size_t i = nodes.size(); i-- > 0;)
+		{
+			if (!used[i]) continue;
+			if (nodes[i].arg1 >= 0) used[nodes[i].arg1] = true;
+			if (nodes[i].arg2 >= 0) used[nodes[i].arg2] = true;
+		}
+
+		std::vector<int> renumbered(nodes.size(), -1);
+		std::vector<Node> kept_nodes;
+		std::vector<std::vector<double>> kept_values;
+		index.clear();
+		for (size_t i = 0; i < nodes.size(); i++)
+		{
+			if (!used[i]) continue;
+
+			Node node = nodes[i];
+			if (node.arg1 >= 0) node.arg1 = renumbered[node.arg1];
+			if (node.arg2 >= 0) node.arg2 = renumbered[node.arg2];
+			renumbered[i] = (int)kept_nodes.size();
+
+			Key key = { node.op, 0, node.arg1, node.arg2 };
+			memcpy(&key.bits, &node.value, sizeof(double));
+			index[key] = renumbered[i];
+
+			kept_nodes.push_back(node);
+			if (i < values.size())
+			{
+				kept_values.push_back(std::vector<double>());
+				kept_values.back().swap(values[i]);
+			}
+		}
+
+		nodes.swap(kept_nodes);
+		values.swap(kept_values);
+
+		std::vector<int> new_roots;
+		for (int root : roots) new_roots.push_back(renumbered[root]);
+		return new_roots;
+	}
+};
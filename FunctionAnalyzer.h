@@ -0,0 +1,240 @@
+#pragma once
+
+#include <vector>
+#include <algorithm>
+#include <float.h>
+#include <math.h>
+#include "Expression.h"
+#include "Derivative.h"
+#include "GraphSampler.h"
+
+enum FeatureKind
+{
+	feature_root,
+	feature_minimum,
+	feature_maximum,
+	feature_intersection,
+};
+
+// A point of interest on a graph.
+struct Feature
+{
+	FeatureKind kind;
+	double x, y;
+	bool found; // False if the bracket it was refined from turned out to hold an asymptote instead
+};
+
+// An interval [a, b] of x that holds a feature. a and b are equal if a sample hit it exactly.
+struct Bracket
+{
+	FeatureKind kind;
+	double a, b;
+};
+
+// Finds the roots and extrema of a function f, or the intersections of the graphs of two functions f and g.
+// The features are first bracketed by the sign changes of f - g and f' between samples, and every bracket is
+// then refined on its own, so several brackets can be refined from several threads at once.
+class FunctionAnalyzer
+{
+private:
+	CompiledExpr f;
+	CompiledExpr g; // 0 when there is only f, so f - g is f
+	CompiledExpr df; // The symbolic derivative of f, which is 0 when analyzing intersections
+	bool intersections;
+
+	// The root of h in [a, b], where h(a) and h(b) have opposite signs. h(x, dh) returns the value of h and
+	// writes its derivative to dh. Newton's method converges in a few steps once it is close, and every
+	// step that would leave the bracket or not shrink it fast enough is replaced by bisection.
+	template <class Func>
+	static double safe_newton(Func h, double a, double b)
+	{
+		double dh;
+		double ha = h(a, dh);
+		if (ha == 0) return a;
+
+		// lo is the end where h is negative
+		double lo = ha < 0 ? a : b;
+		double hi = ha < 0 ? b : a;
+
+		double x = (a + b) / 2;
+		double step = fabs(b - a);
+		double last_step = step;
+		double hx = h(x, dh);
+		double tolerance = 4 * DBL_EPSILON * std::max(fabs(a), fabs(b)) + DBL_MIN;
+
+		for (int i = 0; i < 100 && hx != 0; i++)
+		{
+			bool newton_leaves = ((x - hi) * dh - hx) * ((x - lo) * dh - hx) > 0;
+			bool newton_slow = fabs(2 * hx) > fabs(last_step * dh);
+
+			last_step = step;
+			if (newton_leaves || newton_slow || isnan(dh))
+			{
+				step = (hi - lo) / 2;
+				x = lo + step;
+			}
+			else
+			{
+				step = hx / dh;
+				x -= step;
+			}
+
+			if (fabs(step) < tolerance) break;
+
+			hx = h(x, dh);
+			if (hx < 0) lo = x;
+			else hi = x;
+		}
+
+		return x;
+	}
+
+	void add_bracket(std::vector<Bracket>& brackets, FeatureKind kind, double a, double b) const
+	{
+		Bracket bracket = { kind, a, b };
+		brackets.push_back(bracket);
+	}
+
+	// Brackets the sign changes of the sampled values h, as `rising` where h goes from negative to positive and
+	// `falling` the other way. A zero that a sample hit exactly gets its kind from the samples next to it, and
+	// is left out if h doesn't change sign there unless both kinds are the same. It also only counts if it is a
+	// single sample, so a function that is constantly 0 has no roots.
+	void find_sign_changes(const std::vector<double>& xs, const std::vector<double>& h, FeatureKind rising, FeatureKind falling, std::vector<Bracket>& brackets) const
+	{
+		size_t n = xs.size();
+
+		for (size_t i = 0; i < n; i++)
+		{
+			if (h[i] == 0)
+			{
+				double before = i > 0 ? h[i - 1] : NAN;
+				double after = i + 1 < n ? h[i + 1] : NAN;
+				if (before == 0 || after == 0) continue;
+
+				if (before < 0 && after > 0) this->add_bracket(brackets, rising, xs[i], xs[i]);
+				else if (before > 0 && after < 0) this->add_bracket(brackets, falling, xs[i], xs[i]);
+				else if (rising == falling) this->add_bracket(brackets, rising, xs[i], xs[i]);
+			}
+			else if (i + 1 < n && h[i + 1] != 0 && (h[i] < 0) != (h[i + 1] < 0))
+			{
+				this->add_bracket(brackets, h[i] < 0 ? rising : falling, xs[i], xs[i + 1]);
+			}
+		}
+	}
+
+	// Brackets the features between samples of f - g and f'.
+	std::vector<Bracket> brackets_between(const std::vector<double>& xs, const std::vector<double>& values, const std::vector<double>& derivatives) const
+	{
+		std::vector<Bracket> result;
+
+		if (intersections)
+		{
+			this->find_sign_changes(xs, values, feature_intersection, feature_intersection, result);
+		}
+		else
+		{
+			this->find_sign_changes(xs, values, feature_root, feature_root, result);
+
+			// f has a minimum where f' goes from negative to positive, and a maximum where it goes the other way
+			this->find_sign_changes(xs, derivatives, feature_minimum, feature_maximum, result);
+		}
+
+		return result;
+	}
+
+public:
+	// Samples spread over the x range when none are given. This is enough to find the roots of sin(100x)
+	// over [-100, 100], about 3 samples per root, in a few milliseconds.
+	static const size_t default_samples = 1 << 16;
+
+	// Analyzes the roots and extrema of f.
+	FunctionAnalyzer(const CompiledExpr& _f)
+		: f(_f), g("0"), df(SymbolicExpr(_f).derivative().compile())
+	{
+		intersections = false;
+	}
+
+	// Analyzes the intersections of the graphs of f and g.
+	FunctionAnalyzer(const CompiledExpr& _f, const CompiledExpr& _g)
+		: f(_f), g(_g), df("0")
+	{
+		intersections = true;
+	}
+
+	// Samples f - g and f' from x_from to x_to and brackets all features in between.
+	std::vector<Bracket> brackets(double x_from, double x_to, size_t samples = default_samples) const
+	{
+		if (samples < 2) samples = 2;
+
+		std::vector<double> xs(samples);
+		for (size_t i = 0; i < samples; i++)
+		{
+			xs[i] = x_from + (x_to - x_from) * i / (samples - 1);
+		}
+
+		// The values and derivatives of f come out of one pass over the samples
+		std::vector<double> values(samples), derivatives(samples);
+		f.eval_batch_derivative(xs.data(), xs.data(), values.data(), derivatives.data(), samples);
+
+		if (intersections)
+		{
+			std::vector<double> g_values(samples);
+			g.eval_batch(xs.data(), xs.data(), g_values.data(), samples);
+			for (size_t i = 0; i < samples; i++)
+			{
+				values[i] -= g_values[i];
+			}
+		}
+
+		return this->brackets_between(xs, values, derivatives);
+	}
+
+	// Brackets all features between samples that have already been taken, like those of the graphs that are
+	// drawn, where values are those of f - g at xs. Only f' is evaluated, and only for the extrema.
+	std::vector<Bracket> brackets(const std::vector<double>& xs, const std::vector<double>& values) const
+	{
+		std::vector<double> derivatives;
+		if (!intersections)
+		{
+			derivatives.resize(xs.size());
+			df.eval_batch(xs.data(), xs.data(), derivatives.data(), xs.size());
+		}
+
+		return this->brackets_between(xs, values, derivatives);
+	}
+
+	// Refines a bracket to the feature in it. It is safe to call this from several threads at once.
+	Feature refine(const Bracket& bracket) const
+	{
+		Feature feature = { bracket.kind, bracket.a, 0.0, false };
+
+		// A sign change over an asymptote, like that of 1/x at 0, is not a feature
+		if (has_pole(f, bracket.a, bracket.b) || (intersections && has_pole(g, bracket.a, bracket.b)))
+		{
+			return feature;
+		}
+
+		bool extremum = bracket.kind == feature_minimum || bracket.kind == feature_maximum;
+		if (bracket.a != bracket.b)
+		{
+			if (extremum)
+			{
+				feature.x = safe_newton([this](double x, double& d) { return df.eval_derivative(x, 0.0, d); }, bracket.a, bracket.b);
+			}
+			else
+			{
+				feature.x = safe_newton([this](double x, double& d)
+				{
+					double dg;
+					double value = f.eval_derivative(x, 0.0, d) - g.eval_derivative(x, 0.0, dg);
+					d -= dg;
+					return value;
+				}, bracket.a, bracket.b);
+			}
+		}
+
+		feature.y = f.eval(feature.x);
+		feature.found = isfinite(feature.y);
+		return feature;
+	}
+};
@@ -1,5 +1,5 @@
 QT       += core gui
-QT += charts
+QT += charts concurrent
 
 greaterThan(QT_MAJOR_VERSION, 4): QT += widgets printsupport
 
@@ -22,9 +22,21 @@ SOURCES += \
     qcustomplot.cpp
 
 HEADERS += \
+    Derivative.h \
+    Expression.h \
+    ExpressionDag.h \
+    FunctionAnalyzer.h \
+    GraphSampler.h \
+    ImplicitCurve.h \
     InputHandler.h \
+    Integrator.h \
+    Interval.h \
     Matrix_NxN.h \
+    ODESolver.h \
+    ParametricCurve.h \
     Parser.h \
+    ParserBenchmark.h \
+    SymbolTable.h \
     mainwindow.h \
     qcustomplot.h
 
@@ -0,0 +1,116 @@
+#pragma once
+
+#include <vector>
+#include <limits>
+#include "Expression.h"
+
+// Whether the function has a vertical asymptote somewhere in [a, b]. The interval is bisected `depth` times
+// around the parts where interval arithmetic can't bound the function, which tells an actual asymptote apart
+// from bounds that are just too wide, e.g. those of 1/(x^2-x+1).
+inline bool has_pole(const CompiledExpr& f, double a, double b, int depth = 40)
+{
+	Interval bounds = f.eval_interval(Interval(a, b));
+	if (bounds.is_empty() || bounds.is_bounded()) return false;
+	if (depth == 0) return true;
+
+	double m = (a + b) / 2;
+	if (m <= a || m >= b) return true;
+
+	return has_pole(f, a, m, depth - 1) || has_pole(f, m, b, depth - 1);
+}
+
+// Samples the graph of a function of x once for every pixel of the plot, with interval arithmetic to skip the
+// parts that are entirely above or below the visible values, and to break the graph at its asymptotes instead
+// of drawing a line from one side to the other.
+class GraphSampler
+{
+private:
+	const CompiledExpr& f;
+	double x_min, x_step;
+	size_t num_pixels;
+	double y_min, y_max;
+
+	// Blocks of at most this many pixels where the function is bounded are sampled without dividing them further.
+	static const size_t min_block = 8;
+
+	std::vector<double> xs;
+	std::vector<size_t> breaks;
+
+	double pixel_x(size_t k) const
+	{
+		return x_min + x_step * k;
+	}
+
+	// Adds the samples of the pixels [k0, k1) to xs. The block is halved until the interval bounds of the
+	// function show that it is off the plot or bounded, or until it is a single pixel.
+	void sample_block(size_t k0, size_t k1)
+	{
+		Interval bounds = f.eval_interval(Interval(pixel_x(k0), pixel_x(k1)));
+
+		// Only the first and last samples of a block that can't be seen are kept, so the line leaves and enters
+		// the plot at the right places
+		if (bounds.is_empty() || bounds.lo > y_max || bounds.hi < y_min)
+		{
+			xs.push_back(pixel_x(k0));
+			if (k1 - 1 > k0) xs.push_back(pixel_x(k1 - 1));
+			return;
+		}
+
+		if (bounds.is_bounded() && k1 - k0 <= min_block)
+		{
+			for (size_t k = k0; k < k1; k++)
+			{
+				xs.push_back(pixel_x(k));
+			}
+			return;
+		}
+
+		if (k1 - k0 > 1)
+		{
+			size_t m = (k0 + k1) / 2;
+			this->sample_block(k0, m);
+			this->sample_block(m, k1);
+			return;
+		}
+
+		// The function is unbounded within this pixel. If it is an asymptote, the graph gets a NaN point, which
+		// breaks the line in two.
+		xs.push_back(pixel_x(k0));
+		if (has_pole(f, pixel_x(k0), pixel_x(k1)))
+		{
+			breaks.push_back(xs.size());
+			xs.push_back((pixel_x(k0) + pixel_x(k1)) / 2);
+		}
+	}
+
+public:
+	// Samples [x_from, x_to] at num_pixels + 1 points, where [y_from, y_to] is the visible part of the y-axis.
+	GraphSampler(const CompiledExpr& expr, double x_from, double x_to, size_t _num_pixels, double y_from, double y_to)
+		: f(expr)
+	{
+		num_pixels = _num_pixels > 0 ? _num_pixels : 1;
+		x_min = x_from;
+		x_step = (x_to - x_from) / num_pixels;
+		y_min = y_from;
+		y_max = y_to;
+	}
+
+	// Writes the points of the graph to out_xs and out_ys, sorted by x.
+	void sample(std::vector<double>& out_xs, std::vector<double>& out_ys)
+	{
+		xs.clear();
+		breaks.clear();
+		this->sample_block(0, num_pixels);
+		xs.push_back(pixel_x(num_pixels));
+
+		std::vector<double> ys(xs.size());
+		f.eval_batch(xs.data(), xs.data(), ys.data(), xs.size());
+		for (size_t i : breaks)
+		{
+			ys[i] = std::numeric_limits<double>::quiet_NaN();
+		}
+
+		out_xs.swap(xs);
+		out_ys.swap(ys);
+	}
+};
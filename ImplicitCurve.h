@@ -0,0 +1,304 @@
+#pragma once
+
+#include <vector>
+#include <algorithm>
+#include <unordered_map>
+#include <cstdint>
+#include <math.h>
+#include "Expression.h"
+
+// The output of tracing the curve in one tile of rows of coarse cells.
+struct ImplicitTile
+{
+	int row_begin;
+	int row_end;
+
+	// Every segment connects the crossing points on two cell edges, given by their edge keys.
+	std::vector<uint64_t> segments;
+
+	// The edge keys and positions of the crossing points found in this tile.
+	std::vector<uint64_t> point_keys;
+	std::vector<double> point_xs;
+	std::vector<double> point_ys;
+};
+
+// Traces the curve f(x,y) = 0 with marching squares.
+// The region is first divided into a coarse grid. Only the coarse cells where f changes sign are
+// refined into 2^depth by 2^depth fine cells (recursively, so again only where f changes sign), and
+// the segments are extracted from the fine cells. The work after the coarse pass thus grows with the
+// length of the curve rather than the area.
+class ImplicitCurve
+{
+private:
+	const CompiledExpr& f;
+	double x_min, y_min;
+	double fine_dx, fine_dy;
+	int coarse_nx, coarse_ny;
+	int depth;
+
+	// Position of the corner (i, j) of the fine grid. Computing the position from the integer lattice
+	// makes neighbouring cells agree exactly on the corners they share.
+	double fine_x(int i) const { return x_min + i * fine_dx; }
+	double fine_y(int j) const { return y_min + j * fine_dy; }
+
+	// The edge from corner (i, j) of the fine grid to the right (horizontal) or upwards (vertical).
+	static uint64_t edge_key(int i, int j, bool vertical)
+	{
+		return ((uint64_t)i << 33) | ((uint64_t)j << 1) | (vertical ? 1 : 0);
+	}
+
+	// Values at or above zero count as positive, so a zero at a corner is handled like any other value.
+	static bool has_sign_change(double a, double b, double c, double d)
+	{
+		bool pa = a >= 0, pb = b >= 0, pc = c >= 0, pd = d >= 0;
+		return !(pa == pb && pb == pc && pc == pd);
+	}
+
+	static bool is_valid(double a, double b, double c, double d)
+	{
+		return !isnan(a) && !isnan(b) && !isnan(c) && !isnan(d);
+	}
+
+	// Adds the crossing point on an edge whose corners have the values fa (at the start of the edge) and fb.
+	void add_point(ImplicitTile& tile, int i, int j, bool vertical, double fa, double fb) const
+	{
+		double t = fa / (fa - fb);
+		tile.point_keys.push_back(edge_key(i, j, vertical));
+		tile.point_xs.push_back(vertical ? fine_x(i) : fine_x(i) + t * fine_dx);
+		tile.point_ys.push_back(vertical ? fine_y(j) + t * fine_dy : fine_y(j));
+	}
+
+	void add_segment(ImplicitTile& tile, uint64_t a, uint64_t b) const
+	{
+		tile.segments.push_back(a);
+		tile.segments.push_back(b);
+	}
+
+	// Extracts the segments of the fine cell with lower left corner (i, j) and the corner values
+	// bl (bottom left), br, tr and tl.
+	void march_cell(ImplicitTile& tile, int i, int j, double bl, double br, double tr, double tl) const
+	{
+		bool bottom = (bl >= 0) != (br >= 0);
+		bool right = (br >= 0) != (tr >= 0);
+		bool top = (tl >= 0) != (tr >= 0);
+		bool left = (bl >= 0) != (tl >= 0);
+
+		// The points are always computed from the start of the edge, so both cells sharing the edge get the same point.
+		if (bottom) this->add_point(tile, i, j, false, bl, br);
+		if (right) this->add_point(tile, i + 1, j, true, br, tr);
+		if (top) this->add_point(tile, i, j + 1, false, tl, tr);
+		if (left) this->add_point(tile, i, j, true, bl, tl);
+
+		uint64_t kb = edge_key(i, j, false);
+		uint64_t kr = edge_key(i + 1, j, true);
+		uint64_t kt = edge_key(i, j + 1, false);
+		uint64_t kl = edge_key(i, j, true);
+
+		if (bottom && right && top && left)
+		{
+			// Saddle: the value in the center decides which corners are connected through the middle.
+			double center = f.eval(fine_x(i) + 0.5 * fine_dx, fine_y(j) + 0.5 * fine_dy);
+			if ((center >= 0) == (bl >= 0))
+			{
+				this->add_segment(tile, kb, kr);
+				this->add_segment(tile, kt, kl);
+			}
+			else
+			{
+				this->add_segment(tile, kl, kb);
+				this->add_segment(tile, kr, kt);
+			}
+			return;
+		}
+
+		std::vector<uint64_t> crossed;
+		if (bottom) crossed.push_back(kb);
+		if (right) crossed.push_back(kr);
+		if (top) crossed.push_back(kt);
+		if (left) crossed.push_back(kl);
+
+		if (crossed.size() == 2) this->add_segment(tile, crossed[0], crossed[1]);
+	}
+
+	// Refines the cell of `size` fine cells with lower left corner (i, j) until it reaches the fine grid.
+	void refine(ImplicitTile& tile, int i, int j, int size, double bl, double br, double tr, double tl) const
+	{
+		if (!is_valid(bl, br, tr, tl)) return;
+
+		if (size == 1)
+		{
+			this->march_cell(tile, i, j, bl, br, tr, tl);
+			return;
+		}
+
+		int h = size / 2;
+		double bottom = f.eval(fine_x(i + h), fine_y(j));
+		double right = f.eval(fine_x(i + size), fine_y(j + h));
+		double top = f.eval(fine_x(i + h), fine_y(j + size));
+		double left = f.eval(fine_x(i), fine_y(j + h));
+		double center = f.eval(fine_x(i + h), fine_y(j + h));
+
+		// Only the quarters whose own corners change sign are refined further.
+		if (has_sign_change(bl, bottom, center, left)) this->refine(tile, i, j, h, bl, bottom, center, left);
+		if (has_sign_change(bottom, br, right, center)) this->refine(tile, i + h, j, h, bottom, br, right, center);
+		if (has_sign_change(center, right, tr, top)) this->refine(tile, i + h, j + h, h, center, right, tr, top);
+		if (has_sign_change(left, center, top, tl)) this->refine(tile, i, j + h, h, left, center, top, tl);
+	}
+
+public:
+	// The region [x_min, x_max] x [y_min, y_max] is divided into nx by ny coarse cells, which are
+	// refined `depth` times where the curve passes.
+	ImplicitCurve(const CompiledExpr& expr, double _x_min, double _x_max, double _y_min, double _y_max, int nx, int ny, int _depth)
+		: f(expr)
+	{
+		x_min = _x_min;
+		y_min = _y_min;
+		coarse_nx = nx;
+		coarse_ny = ny;
+		depth = _depth;
+		fine_dx = (_x_max - _x_min) / (nx << depth);
+		fine_dy = (_y_max - _y_min) / (ny << depth);
+	}
+
+	int rows() const
+	{
+		return coarse_ny;
+	}
+
+	// Traces the curve in the coarse rows [tile.row_begin, tile.row_end).
+	// Tiles with different rows can be traced from several threads at once.
+	void trace(ImplicitTile& tile) const
+	{
+		int size = 1 << depth;
+		int n = coarse_nx + 1;
+
+		// Evaluate the corners of the coarse cells, one row of corners at a time.
+		std::vector<double> xs(n), ys(n);
+		std::vector<double> lower(n), upper(n);
+		for (int c = 0; c < n; c++)
+		{
+			xs[c] = fine_x(c * size);
+		}
+
+		std::fill(ys.begin(), ys.end(), fine_y(tile.row_begin * size));
+		f.eval_batch(xs.data(), ys.data(), lower.data(), n);
+
+		for (int r = tile.row_begin; r < tile.row_end; r++)
+		{
+			std::fill(ys.begin(), ys.end(), fine_y((r + 1) * size));
+			f.eval_batch(xs.data(), ys.data(), upper.data(), n);
+
+			for (int c = 0; c < coarse_nx; c++)
+			{
+				if (has_sign_change(lower[c], lower[c + 1], upper[c + 1], upper[c]))
+				{
+					this->refine(tile, c * size, r * size, size, lower[c], lower[c + 1], upper[c + 1], upper[c]);
+				}
+			}
+
+			lower.swap(upper);
+		}
+	}
+
+	// Joins the segments of all tiles into polylines. The polylines are written one after another to
+	// xs and ys, separated by a NaN point so they can be given to a QCPCurve as a whole.
+	void stitch(const std::vector<ImplicitTile>& tiles, std::vector<double>& xs, std::vector<double>& ys) const
+	{
+		struct Node
+		{
+			double x, y;
+			uint64_t next[2];
+			int degree;
+			bool visited;
+		};
+
+		std::unordered_map<uint64_t, Node> nodes;
+
+		for (const ImplicitTile& tile : tiles)
+		{
+			for (size_t p = 0; p < tile.point_keys.size(); p++)
+			{
+				Node& node = nodes[tile.point_keys[p]];
+				node.x = tile.point_xs[p];
+				node.y = tile.point_ys[p];
+			}
+		}
+
+		for (auto& entry : nodes)
+		{
+			entry.second.degree = 0;
+			entry.second.visited = false;
+		}
+
+		for (const ImplicitTile& tile : tiles)
+		{
+			for (size_t s = 0; s + 1 < tile.segments.size(); s += 2)
+			{
+				uint64_t a = tile.segments[s], b = tile.segments[s + 1];
+				Node& na = nodes[a];
+				Node& nb = nodes[b];
+				if (na.degree < 2) na.next[na.degree++] = b;
+				if (nb.degree < 2) nb.next[nb.degree++] = a;
+			}
+		}
+
+		// Follows the polyline from `start` until it ends or closes.
+		auto walk = [&](uint64_t start)
+		{
+			if (!xs.empty())
+			{
+				xs.push_back(NAN);
+				ys.push_back(NAN);
+			}
+
+			uint64_t key = start;
+			Node* node = &nodes[key];
+
+			while (true)
+			{
+				node->visited = true;
+				xs.push_back(node->x);
+				ys.push_back(node->y);
+
+				Node* next = NULL;
+				for (int k = 0; k < node->degree; k++)
+				{
+					Node* candidate = &nodes[node->next[k]];
+					if (!candidate->visited)
+					{
+						next = candidate;
+						break;
+					}
+				}
+
+				if (next == NULL)
+				{
+					// Close the loop if the polyline came back to where it started.
+					Node* first = &nodes[start];
+					for (int k = 0; k < node->degree; k++)
+					{
+						if (node != first && &nodes[node->next[k]] == first && xs.size() > 2)
+						{
+							xs.push_back(first->x);
+							ys.push_back(first->y);
+							break;
+						}
+					}
+					break;
+				}
+
+				node = next;
+			}
+		};
+
+		// Open polylines start at their ends, everything that is left afterwards is a closed loop.
+		for (auto& entry : nodes)
+		{
+			if (!entry.second.visited && entry.second.degree == 1) walk(entry.first);
+		}
+		for (auto& entry : nodes)
+		{
+			if (!entry.second.visited && entry.second.degree == 2) walk(entry.first);
+		}
+	}
+};
@@ -6,6 +6,9 @@
 #include <vector>
 #include "Matrix_NxN.h"
 #include "Parser.h"
+#include "Expression.h"
+#include "GraphSampler.h"
+#include "ODESolver.h"
 
 struct BadInputFormat : public std::exception {};
 struct UnknownIdentifier : public std::exception {};
@@ -15,15 +18,68 @@ enum InputKind
 	vect,  // V(...)
 	func,  // F(...)
 	point, // P(...)
+	field, // H(...), a heatmap of an expression in x and y
+	implicit, // I(...), a curve given by an equation in x and y
+	contour, // C(...), contour lines of an expression in x and y
+	parametric, // T(...), a curve (x(t), y(t)) given by two expressions in t
+	polar, // R(...), a polar curve r(theta)
+	slope, // S(...), the slope field of the differential equation y' = f(x,y)
+	ode, // O(...), solutions of the differential equation y' = f(x,y), with rk45 or rk4
+	derivative, // D(...), the first or n'th derivative of a function of x
+	zeros, // Z(...), the roots of a function of x
+	extrema, // E(...), the minima and maxima of a function of x
+	intersections, // X(...), the intersections of the graphs of two functions of x
+	integral, // A(...), the area under a function of x between two limits
+	definition, // name = ... or name(x) = ..., a number or function the other inputs can use
+	slider, // L(...), a slider that sets a defined number between two limits
 };
 
 class InputHandler
 {
 private:
 	std::string inp;
+	const SymbolMap* symbols;
+
+	// Splits a definition `name = body` or `name(param) = body` into its parts. Returns false if the input
+	// isn't written like a definition.
+	static bool split_definition(const std::string& str, std::string& name, std::string& param, std::string& body)
+	{
+		size_t eq = str.find('=');
+		if (eq == std::string::npos) return false;
+
+		std::string lhs;
+		for (char c : str.substr(0, eq))
+		{
+			if (!isspace(c)) lhs += c;
+		}
+
+		size_t open = lhs.find('(');
+		name = lhs.substr(0, open);
+		param = "";
+		if (open != std::string::npos)
+		{
+			if (lhs.back() != ')') return false;
+			param = lhs.substr(open + 1, lhs.length() - open - 2);
+			if (param.empty()) return false;
+		}
+
+		for (char c : name + param)
+		{
+			if (!isalpha(c)) return false;
+		}
+
+		body = str.substr(eq + 1);
+		return !name.empty();
+	}
 
 	InputKind deduce_inp_kind(std::string str)
 	{
+		std::string name, param, body;
+		if (split_definition(str, name, param, body))
+		{
+			return InputKind::definition;
+		}
+
 		// Input length must be at least 4. 1 char for identifier,
 		// 2 chars for parentheses, and at least 1 char for content.
 		if (str.length() < 4 || !isalpha(str[0]) || str[1] != '(' || str[str.length() - 1] != ')')
@@ -47,21 +103,137 @@ private:
 			return InputKind::point;
 			break;
 
+		case 'H':
+			return InputKind::field;
+			break;
+
+		case 'I':
+			return InputKind::implicit;
+			break;
+
+		case 'C':
+			return InputKind::contour;
+			break;
+
+		case 'T':
+			return InputKind::parametric;
+			break;
+
+		case 'R':
+			return InputKind::polar;
+			break;
+
+		case 'S':
+			return InputKind::slope;
+			break;
+
+		case 'O':
+			return InputKind::ode;
+			break;
+
+		case 'D':
+			return InputKind::derivative;
+			break;
+
+		case 'Z':
+			return InputKind::zeros;
+			break;
+
+		case 'E':
+			return InputKind::extrema;
+			break;
+
+		case 'X':
+			return InputKind::intersections;
+			break;
+
+		case 'A':
+			return InputKind::integral;
+			break;
+
+		case 'L':
+			return InputKind::slider;
+			break;
+
 		default:
 			throw UnknownIdentifier();
 			break;
 		}
 	}
 
+	// Compiles the right hand side of a differential equation y'=f(x,y). The "y'=" may be left out.
+	CompiledExpr compile_rhs(std::string content)
+	{
+		size_t eq = content.find('=');
+
+		if (eq != std::string::npos)
+		{
+			std::string lhs;
+			for (char c : content.substr(0, eq))
+			{
+				if (!isspace(c)) lhs += c;
+			}
+
+			if (lhs != "y'")
+			{
+				throw BadInputFormat();
+			}
+
+			content = content.substr(eq + 1);
+		}
+
+		CompiledExpr expr(content, symbols);
+		return expr;
+	}
+
+	// Reads the limits of a curve parameter from parts[first] and parts[first + 1], if they are given.
+	// Otherwise the parameter goes once around, from 0 to 2*pi.
+	void read_limits(const std::vector<std::string>& parts, size_t first, double& from, double& to)
+	{
+		from = 0;
+		to = 2 * M_PI;
+
+		if (parts.size() > first)
+		{
+			from = CompiledExpr(parts[first], symbols).eval(0);
+			to = CompiledExpr(parts[first + 1], symbols).eval(0);
+
+			if (!isfinite(from) || !isfinite(to))
+			{
+				throw BadInputFormat();
+			}
+		}
+	}
+
 public:
 	InputKind inp_kind;
 
-	InputHandler(std::string _inp)
+	// The highest derivative D(f, n) can plot. Every derivative is a bigger expression than the one before.
+	static const size_t max_derivative_order = 10;
+
+	// The expressions of the input can use the names defined in _symbols, if it is given.
+	InputHandler(std::string _inp, const SymbolMap* _symbols = NULL)
 	{
 		inp = _inp;
+		symbols = _symbols;
 		inp_kind = this->deduce_inp_kind(inp);
 	}
 
+	// Reads the parts of a definition `name = body` or `name(param) = body`.
+	void read_definition(std::string& name, std::string& param, std::string& body)
+	{
+		if (!split_definition(inp, name, param, body))
+		{
+			throw BadInputFormat();
+		}
+	}
+
+	// The expressions inside the parentheses, without the identifier in front.
+	std::string content()
+	{
+		return inp.substr(2, inp.length() - 3);
+	}
+
 	Vector_N<2> evaluate_vec()
 	{
 		std::stringstream cont_ss;
@@ -77,29 +249,285 @@ public:
 		return p.eval_expr_vec();
 	}
 
-	std::vector<Vector_N<2>> evaluate_func(double from, double to, double spacing)
+	// Compiles the expression inside the parentheses, so it can be evaluated for many values of x and y.
+	CompiledExpr compile_expr()
 	{
-		std::vector<Vector_N<2>> data;
+		// The input has to have room for an identifier and the parentheses
+		if (inp.length() < 3)
+		{
+			throw BadInputFormat();
+		}
 
-		for (double x = from; x <= to; x += spacing)
+		std::stringstream cont_ss;
+
+		for (size_t i = 2; i < inp.length() - 1; i++)
+		{
+			cont_ss << inp[i];
+		}
+
+		CompiledExpr expr(cont_ss.str(), symbols);
+		return expr;
+	}
+
+	// Compiles the equation inside the parentheses as lhs - rhs, so the curve is where the result is 0.
+	// Without an equals sign the expression itself is set equal to 0.
+	CompiledExpr compile_equation()
+	{
+		std::string content = inp.substr(2, inp.length() - 3);
+		size_t eq = content.find('=');
+
+		if (eq == std::string::npos)
+		{
+			CompiledExpr expr(content, symbols);
+			return expr;
+		}
+
+		if (content.find('=', eq + 1) != std::string::npos)
+		{
+			throw BadInputFormat();
+		}
+
+		CompiledExpr expr("(" + content.substr(0, eq) + ")-(" + content.substr(eq + 1) + ")", symbols);
+		return expr;
+	}
+
+	// Splits the content inside the parentheses at the commas that are not inside nested parentheses.
+	std::vector<std::string> split_content()
+	{
+		std::vector<std::string> parts;
+		std::string content = inp.substr(2, inp.length() - 3);
+		int depth = 0;
+		size_t start = 0;
+
+		for (size_t i = 0; i < content.length(); i++)
 		{
-			
-			std::stringstream cont_ss;
-			for (int i = 2; i < inp.length() - 1; i++)
+			if (content[i] == '(') depth++;
+			if (content[i] == ')') depth--;
+
+			if (content[i] == ',' && depth == 0)
 			{
-				if (inp[i] == 'x')
-					cont_ss << '(' << (x < 0 ? "0" : "") << std::to_string(x) << ')';
-				else
-				{
-					cont_ss << inp[i];
-				}
+				parts.push_back(content.substr(start, i - start));
+				start = i + 1;
 			}
-			std::string content = cont_ss.str();
+		}
+		parts.push_back(content.substr(start));
+
+		return parts;
+	}
+
+	// Compiles the two components of a parametric curve T(x(t), y(t)) or T(x(t), y(t), t_min, t_max).
+	// Without limits, t goes from 0 to 2*pi.
+	std::vector<CompiledExpr> compile_parametric(double& t_min, double& t_max)
+	{
+		std::vector<std::string> parts = this->split_content();
 
-			Parser p(content);
-			double y = p.eval_expr_num();
+		if (parts.size() != 2 && parts.size() != 4)
+		{
+			throw BadInputFormat();
+		}
+
+		this->read_limits(parts, 2, t_min, t_max);
+
+		std::vector<CompiledExpr> components;
+		components.push_back(CompiledExpr(parts[0], symbols));
+		components.push_back(CompiledExpr(parts[1], symbols));
+		return components;
+	}
+
+	// Compiles the radius of a polar curve R(r(theta)) or R(r(theta), theta_min, theta_max).
+	// Without limits, theta goes from 0 to 2*pi.
+	CompiledExpr compile_polar(double& theta_min, double& theta_max)
+	{
+		std::vector<std::string> parts = this->split_content();
+
+		if (parts.size() != 1 && parts.size() != 3)
+		{
+			throw BadInputFormat();
+		}
+
+		this->read_limits(parts, 1, theta_min, theta_max);
+
+		CompiledExpr expr(parts[0], symbols);
+		return expr;
+	}
+
+	// Compiles the differential equation of a slope field S(y'=f(x,y)).
+	CompiledExpr compile_slope()
+	{
+		return compile_rhs(inp.substr(2, inp.length() - 3));
+	}
+
+	// Compiles the differential equation of O(y'=f(x,y)) or O(y'=f(x,y), x0, y0). With an initial condition
+	// (x0, y0) it is written to x0s and y0s, otherwise they are left empty.
+	// Either can end with the method, rk4 or rk45, which is written to method. Without it, it is rk45.
+	CompiledExpr compile_ode(std::vector<double>& x0s, std::vector<double>& y0s, ODEMethod& method)
+	{
+		std::vector<std::string> parts = this->split_content();
+
+		method = dormand_prince;
+		std::string last;
+		for (char c : parts.back())
+		{
+			if (!isspace(c)) last += c;
+		}
+		if (parts.size() > 1 && (last == "rk4" || last == "rk45"))
+		{
+			method = last == "rk4" ? rk4 : dormand_prince;
+			parts.pop_back();
+		}
+
+		if (parts.size() != 1 && parts.size() != 3)
+		{
+			throw BadInputFormat();
+		}
+
+		if (parts.size() == 3)
+		{
+			double x0 = CompiledExpr(parts[1], symbols).eval(0);
+			double y0 = CompiledExpr(parts[2], symbols).eval(0);
+
+			if (!isfinite(x0) || !isfinite(y0))
+			{
+				throw BadInputFormat();
+			}
+
+			x0s.push_back(x0);
+			y0s.push_back(y0);
+		}
+
+		return compile_rhs(parts[0]);
+	}
+
+	// Compiles the function of A(f, a, b) and writes the limits a and b to from and to.
+	CompiledExpr compile_integral(double& from, double& to)
+	{
+		std::vector<std::string> parts = this->split_content();
+
+		if (parts.size() != 3)
+		{
+			throw BadInputFormat();
+		}
+
+		this->read_limits(parts, 1, from, to);
+
+		CompiledExpr expr(parts[0], symbols);
+		return expr;
+	}
+
+	// Reads the name of the number a slider L(name, from, to) sets, and writes its limits to from and to.
+	std::string read_slider(double& from, double& to)
+	{
+		std::vector<std::string> parts = this->split_content();
+
+		if (parts.size() != 3)
+		{
+			throw BadInputFormat();
+		}
+
+		this->read_limits(parts, 1, from, to);
+		if (!(from < to))
+		{
+			throw BadInputFormat();
+		}
+
+		std::string name;
+		for (char c : parts[0])
+		{
+			if (!isspace(c)) name += c;
+		}
+
+		return name;
+	}
+
+	// Compiles the two functions of X(f, g).
+	std::vector<CompiledExpr> compile_pair()
+	{
+		std::vector<std::string> parts = this->split_content();
+
+		if (parts.size() != 2)
+		{
+			throw BadInputFormat();
+		}
+
+		std::vector<CompiledExpr> funcs;
+		funcs.push_back(CompiledExpr(parts[0], symbols));
+		funcs.push_back(CompiledExpr(parts[1], symbols));
+		return funcs;
+	}
+
+	// Reads D(f) or D(f, n), the n'th derivative of f. Returns the function f and writes the order to order,
+	// which is 1 if it is left out and must be a whole number from 0 to max_derivative_order.
+	std::string derivative_func(size_t& order)
+	{
+		std::vector<std::string> parts = this->split_content();
+
+		if (parts.size() != 1 && parts.size() != 2)
+		{
+			throw BadInputFormat();
+		}
+
+		order = 1;
+		if (parts.size() == 2)
+		{
+			double n = CompiledExpr(parts[1], symbols).eval(0);
+
+			if (!(n >= 0 && n <= max_derivative_order) || n != floor(n))
+			{
+				throw BadInputFormat();
+			}
+
+			order = (size_t)n;
+		}
+
+		return parts[0];
+	}
+
+	// The x-values at every spacing from `from` to `to`, where the graph of F(...) is evaluated.
+	static std::vector<double> func_grid(double from, double to, double spacing)
+	{
+		std::vector<double> xs;
+
+		for (double x = from; x <= to; x += spacing)
+		{
+			xs.push_back(x);
+		}
+
+		return xs;
+	}
+
+	// Whether the values ys can have an asymptote between the points i - 1 and i. Next to an asymptote the
+	// values aren't finite, change sign, jump, or go up to it and back down, so the values turn around there.
+	// No line is drawn between two points where the function isn't defined, so it needn't be broken there.
+	static bool may_have_pole(const std::vector<double>& ys, size_t i)
+	{
+		if (isnan(ys[i - 1]) && isnan(ys[i])) return false;
+		if (!isfinite(ys[i - 1]) || !isfinite(ys[i]) || (ys[i - 1] < 0) != (ys[i] < 0)) return true;
+
+		double before = i >= 2 ? ys[i - 1] - ys[i - 2] : 0.0;
+		double step = ys[i] - ys[i - 1];
+		double after = i + 1 < ys.size() ? ys[i + 1] - ys[i] : 0.0;
+		if ((before > 0 && after < 0) || (before < 0 && after > 0)) return true;
+
+		return fabs(step) > 8 * (fabs(before) + fabs(after));
+	}
+
+	// The points of the graph of f, where ys are its values at the x-values xs. Where it has an asymptote
+	// between two points, a point with y = NaN is put in between, so the graph is broken there. Only the
+	// pieces where the values look like they could have one are checked with interval arithmetic, the values
+	// themselves come from wherever the graph was evaluated.
+	static std::vector<Vector_N<2>> graph_points(const CompiledExpr& f, const std::vector<double>& xs, const std::vector<double>& ys)
+	{
+		std::vector<Vector_N<2>> data;
+
+		for (size_t i = 0; i < xs.size(); i++)
+		{
+			if (i > 0 && may_have_pole(ys, i) && has_pole(f, xs[i - 1], xs[i]))
+			{
+				double barr[2] = { (xs[i - 1] + xs[i]) / 2, NAN };
+				data.push_back(Vector_N<2>(barr));
+			}
 
-			double varr[2] = { x, y };
+			double varr[2] = { xs[i], ys[i] };
 			Vector_N<2> dp(varr);
 
 			data.push_back(dp);
@@ -0,0 +1,177 @@
+#pragma once
+
+#include <vector>
+#include <math.h>
+#include "Expression.h"
+
+// The result of a numerical integration: the integral, an estimate of how far it is off at most, and the
+// number of evaluations of the function it took.
+struct Quadrature
+{
+	double value;
+	double error;
+	size_t evaluations;
+};
+
+// Integrates a function of x over a finite interval with adaptive Gauss-Kronrod quadrature.
+// Every interval is integrated with the 15 point Kronrod rule, and the 7 point Gauss rule on the same nodes
+// estimates its error. The intervals with the largest errors are halved until the total error is small enough,
+// and all new intervals are evaluated together in one batch.
+// `integrate` has no state of its own, so several intervals can be integrated from several threads at once.
+class Integrator
+{
+private:
+	const CompiledExpr& f;
+	double rel_tolerance, abs_tolerance;
+
+	// No integral is split into more intervals than this.
+	static const size_t max_intervals = 1 << 16;
+
+	// Every integral starts out split into this many intervals. With fewer, both rules could miss a narrow peak
+	// and agree on the wrong integral, like that of e^(-x^2) from -10 to 10 in a single interval.
+	static const size_t first_intervals = 16;
+
+	struct Piece
+	{
+		double a, b;
+		double value, error;
+	};
+
+	// Applies the Gauss-Kronrod rule to every piece, with the nodes of all pieces evaluated in one batch.
+	void apply_rule(std::vector<Piece>& pieces, size_t& evaluations) const
+	{
+		// The nodes on [-1, 1] are +-kronrod_nodes, and the Gauss nodes are every second of them, ending with 0
+		static const double kronrod_nodes[8] = {
+			0.991455371120812639206854697526329, 0.949107912342758524526189684047851,
+			0.864864423359769072789712788640926, 0.741531185599394439863864773280788,
+			0.586087235467691130294144845693013, 0.405845151377397166906606412076961,
+			0.207784955007898467600689403773245, 0.0 };
+		static const double kronrod_weights[8] = {
+			0.022935322010529224963732008058970, 0.063092092629978553290700663189204,
+			0.104790010322250183839876322541518, 0.140653259715525918745189590510238,
+			0.169004726639267902826583426598550, 0.190350578064785409913256402421014,
+			0.204432940075298892414161999234649, 0.209482141084727828012999174891714 };
+		static const double gauss_weights[4] = {
+			0.129484966168869693270611432679082, 0.279705391489276667901467771423780,
+			0.381830050505118944950369775488975, 0.417959183673469387755102040816327 };
+
+		size_t n = pieces.size();
+		std::vector<double> xs(15 * n), ys(15 * n);
+
+		for (size_t i = 0; i < n; i++)
+		{
+			double center = (pieces[i].a + pieces[i].b) / 2;
+			double half = (pieces[i].b - pieces[i].a) / 2;
+			double* x = &xs[15 * i];
+
+			for (int k = 0; k < 7; k++)
+			{
+				x[2 * k] = center - half * kronrod_nodes[k];
+				x[2 * k + 1] = center + half * kronrod_nodes[k];
+			}
+			x[14] = center;
+		}
+
+		f.eval_batch(xs.data(), xs.data(), ys.data(), xs.size());
+		evaluations += xs.size();
+
+		for (size_t i = 0; i < n; i++)
+		{
+			double half = (pieces[i].b - pieces[i].a) / 2;
+			const double* y = &ys[15 * i];
+			double kronrod = kronrod_weights[7] * y[14];
+			double gauss = gauss_weights[3] * y[14];
+
+			for (int k = 0; k < 7; k++)
+			{
+				double pair = y[2 * k] + y[2 * k + 1];
+				kronrod += kronrod_weights[k] * pair;
+				if (k % 2 == 1) gauss += gauss_weights[k / 2] * pair;
+			}
+
+			pieces[i].value = kronrod * half;
+			pieces[i].error = fabs(kronrod - gauss) * fabs(half);
+		}
+	}
+
+public:
+	// The integral is done when its error estimate is below rel_tolerance times its size or below abs_tolerance.
+	Integrator(const CompiledExpr& expr, double _rel_tolerance = 1e-10, double _abs_tolerance = 1e-12)
+		: f(expr)
+	{
+		rel_tolerance = _rel_tolerance;
+		abs_tolerance = _abs_tolerance;
+	}
+
+	// Splits [a, b] into n intervals of the same width, which can then be integrated in parallel. Returns their n + 1 ends.
+	static std::vector<double> split(double a, double b, size_t n)
+	{
+		std::vector<double> ends(n + 1);
+		for (size_t i = 0; i <= n; i++)
+		{
+			ends[i] = a + (b - a) * i / n;
+		}
+		ends[n] = b;
+
+		return ends;
+	}
+
+	// Integrates f from a to b. If f isn't defined everywhere on [a, b], the integral is NaN.
+	Quadrature integrate(double a, double b) const
+	{
+		Quadrature result = { 0.0, 0.0, 0 };
+		if (a == b) return result;
+
+		std::vector<double> ends = split(a, b, first_intervals);
+		std::vector<Piece> pieces(first_intervals);
+		for (size_t i = 0; i < first_intervals; i++)
+		{
+			pieces[i].a = ends[i];
+			pieces[i].b = ends[i + 1];
+		}
+		this->apply_rule(pieces, result.evaluations);
+
+		while (true)
+		{
+			result.value = 0;
+			result.error = 0;
+			for (const Piece& piece : pieces)
+			{
+				result.value += piece.value;
+				result.error += piece.error;
+			}
+
+			double tolerance = std::max(abs_tolerance, rel_tolerance * fabs(result.value));
+			if (!(result.error > tolerance) || pieces.size() >= max_intervals) break;
+
+			// Every piece with more than its share of the tolerance by width is halved, the left half in its
+			// place and the right half at the end
+			std::vector<Piece> halves;
+			std::vector<size_t> halved;
+			for (size_t i = 0; i < pieces.size() && pieces.size() + halves.size() < max_intervals; i++)
+			{
+				Piece& piece = pieces[i];
+				double middle = (piece.a + piece.b) / 2;
+				if (piece.error <= tolerance * fabs((piece.b - piece.a) / (b - a)) || middle == piece.a || middle == piece.b) continue;
+
+				Piece left = { piece.a, middle, 0.0, 0.0 };
+				Piece right = { middle, piece.b, 0.0, 0.0 };
+				halves.push_back(left);
+				halves.push_back(right);
+				halved.push_back(i);
+			}
+
+			// The pieces can't be halved any further, e.g. at a singularity the integral doesn't converge at
+			if (halves.empty()) break;
+
+			this->apply_rule(halves, result.evaluations);
+			for (size_t j = 0; j < halved.size(); j++)
+			{
+				pieces[halved[j]] = halves[2 * j];
+				pieces.push_back(halves[2 * j + 1]);
+			}
+		}
+
+		return result;
+	}
+};
@@ -0,0 +1,175 @@
+#pragma once
+
+#include <algorithm>
+#include <limits>
+#include <math.h>
+
+// A range of numbers [lo, hi] that contains every value an expression can take when its variables range over
+// other intervals. The bounds can be infinite, and an interval where the expression isn't defined at all,
+// like sqrt of a negative interval, is empty and has NaN bounds.
+// The bounds are not rounded outwards, so they can be off by a rounding error, which doesn't matter on a plot.
+struct Interval
+{
+	double lo, hi;
+
+	Interval() : lo(0), hi(0) {}
+	Interval(double value) : lo(value), hi(value) {}
+	Interval(double _lo, double _hi) : lo(_lo), hi(_hi) {}
+
+	static Interval empty()
+	{
+		double nan = std::numeric_limits<double>::quiet_NaN();
+		return Interval(nan, nan);
+	}
+
+	static Interval whole()
+	{
+		double inf = std::numeric_limits<double>::infinity();
+		return Interval(-inf, inf);
+	}
+
+	bool is_empty() const
+	{
+		return isnan(lo) || isnan(hi);
+	}
+
+	// Whether both bounds are finite. An expression that is unbounded on an interval of x can have a vertical
+	// asymptote there.
+	bool is_bounded() const
+	{
+		return isfinite(lo) && isfinite(hi);
+	}
+
+	bool contains(double value) const
+	{
+		return lo <= value && value <= hi;
+	}
+};
+
+inline Interval operator+(Interval a, Interval b)
+{
+	if (a.is_empty() || b.is_empty()) return Interval::empty();
+
+	// inf + -inf is NaN, but the sum can then be anything
+	double lo = a.lo + b.lo;
+	double hi = a.hi + b.hi;
+	return Interval(isnan(lo) ? -INFINITY : lo, isnan(hi) ? INFINITY : hi);
+}
+
+inline Interval operator-(Interval a)
+{
+	return Interval(-a.hi, -a.lo);
+}
+
+inline Interval operator-(Interval a, Interval b)
+{
+	return a + -b;
+}
+
+inline Interval operator*(Interval a, Interval b)
+{
+	if (a.is_empty() || b.is_empty()) return Interval::empty();
+
+	// An infinite bound is never reached, so 0 times it is 0 and not NaN
+	auto mul = [](double u, double v) { return u == 0 || v == 0 ? 0.0 : u * v; };
+	double p[4] = { mul(a.lo, b.lo), mul(a.lo, b.hi), mul(a.hi, b.lo), mul(a.hi, b.hi) };
+	return Interval(*std::min_element(p, p + 4), *std::max_element(p, p + 4));
+}
+
+inline Interval operator/(Interval a, Interval b)
+{
+	if (a.is_empty() || b.is_empty()) return Interval::empty();
+
+	// Dividing by an interval around 0 can give anything
+	if (b.contains(0)) return Interval::whole();
+
+	return a * Interval(1 / b.hi, 1 / b.lo);
+}
+
+inline Interval pow(Interval a, Interval b)
+{
+	if (a.is_empty() || b.is_empty()) return Interval::empty();
+
+	if (b.lo == b.hi && b.lo == floor(b.lo) && fabs(b.lo) < 1e15)
+	{
+		// A whole exponent n is defined for negative numbers too, and a^n is monotone on both sides of 0
+		double n = b.lo;
+		if (n == 0) return Interval(1);
+
+		double e1 = pow(a.lo, n), e2 = pow(a.hi, n);
+		bool even = fmod(n, 2) == 0;
+
+		if (a.contains(0))
+		{
+			if (n > 0 && even) return Interval(0, std::max(e1, e2));
+			if (n < 0 && even) return Interval(std::min(e1, e2), INFINITY);
+			if (n < 0) return Interval::whole();
+		}
+
+		return Interval(std::min(e1, e2), std::max(e1, e2));
+	}
+
+	// Other powers of negative numbers are only defined for some of the exponents, if any
+	if (a.hi < 0 && b.lo == b.hi) return Interval::empty();
+	if (a.lo < 0) return Interval::whole();
+
+	// a^b of a >= 0 is monotone in both a and b, so it is largest and smallest in the corners
+	double p[4] = { pow(a.lo, b.lo), pow(a.lo, b.hi), pow(a.hi, b.lo), pow(a.hi, b.hi) };
+	for (double v : p)
+	{
+		if (isnan(v)) return Interval::whole();
+	}
+	return Interval(*std::min_element(p, p + 4), *std::max_element(p, p + 4));
+}
+
+inline Interval cos(Interval a)
+{
+	if (a.is_empty()) return Interval::empty();
+	if (!a.is_bounded() || a.hi - a.lo >= 2 * M_PI) return Interval(-1, 1);
+
+	double c1 = cos(a.lo), c2 = cos(a.hi);
+	Interval result(std::min(c1, c2), std::max(c1, c2));
+
+	// The maxima of cos are at 2k*pi and the minima at pi + 2k*pi
+	if (a.contains(2 * M_PI * ceil(a.lo / (2 * M_PI)))) result.hi = 1;
+	if (a.contains(M_PI + 2 * M_PI * ceil((a.lo - M_PI) / (2 * M_PI)))) result.lo = -1;
+
+	return result;
+}
+
+inline Interval sin(Interval a)
+{
+	return cos(a - Interval(M_PI_2));
+}
+
+inline Interval tan(Interval a)
+{
+	if (a.is_empty()) return Interval::empty();
+	if (!a.is_bounded() || a.hi - a.lo >= M_PI) return Interval::whole();
+
+	// tan has its asymptotes at pi/2 + k*pi and is increasing between them
+	if (a.contains(M_PI_2 + M_PI * ceil((a.lo - M_PI_2) / M_PI))) return Interval::whole();
+
+	return Interval(tan(a.lo), tan(a.hi));
+}
+
+inline Interval sqrt(Interval a)
+{
+	if (a.is_empty() || a.hi < 0) return Interval::empty();
+
+	return Interval(sqrt(std::max(a.lo, 0.0)), sqrt(a.hi));
+}
+
+inline Interval log(Interval a)
+{
+	if (a.is_empty() || a.hi < 0) return Interval::empty();
+
+	return Interval(log(std::max(a.lo, 0.0)), log(a.hi));
+}
+
+inline Interval log10(Interval a)
+{
+	if (a.is_empty() || a.hi < 0) return Interval::empty();
+
+	return Interval(log10(std::max(a.lo, 0.0)), log10(a.hi));
+}
@@ -0,0 +1,211 @@
+#pragma once
+
+#include <algorithm>
+#include <math.h>
+#include "Expression.h"
+
+// The methods `ODESolver` can integrate with.
+enum ODEMethod
+{
+	rk4, // The classical Runge-Kutta method with a fixed step
+	dormand_prince, // Dormand-Prince 5(4) with an adaptive step
+};
+
+// Integrates the differential equation y' = f(x,y) from an initial condition (x0, y0) towards x_end.
+// The accuracy is given in pixels, so a solution is computed just as precisely as it can be seen: x_scale
+// and y_scale are the number of pixels per unit on the axes.
+// The solver has no state of its own while solving, so several solutions can be computed from several
+// threads at once.
+class ODESolver
+{
+private:
+	const CompiledExpr& f;
+	double x_scale, y_scale;
+
+	// The largest error of a step in pixels, and the distance in pixels between the output points.
+	double tolerance;
+	double spacing;
+
+	// The solution is stopped once y leaves [y_low, y_high], since it is then far outside the plot.
+	double y_low, y_high;
+
+	// No solution gets more points than this in one direction.
+	static const size_t max_points = 1000000;
+
+	// The steepest slope on screen a solution can have, in pixels up per pixel to the right.
+	static constexpr double max_pixel_slope = 1e4;
+
+	// The largest angle in radians the solution may turn on screen in one step.
+	static constexpr double max_turn = 2.0;
+
+	bool is_outside(double y) const
+	{
+		return !isfinite(y) || y < y_low || y > y_high;
+	}
+
+	// Outputs the points between (x0, y0) and (x1, y1), not including the first one, with about `spacing`
+	// pixels between them. The solution in between is interpolated with a cubic through the end points
+	// and their slopes f0 and f1, which doesn't need any more evaluations of f.
+	template <class Out>
+	size_t output_step(double x0, double y0, double f0, double x1, double y1, double f1, Out& out) const
+	{
+		double h = x1 - x0;
+		double length = hypot(h * x_scale, (y1 - y0) * y_scale);
+		size_t n = length > spacing ? (size_t)ceil(length / spacing) : 1;
+
+		for (size_t k = 1; k < n; k++)
+		{
+			double s = (double)k / n;
+			double s2 = s * s, s3 = s2 * s;
+			double y = (2 * s3 - 3 * s2 + 1) * y0 + (s3 - 2 * s2 + s) * h * f0
+				+ (-2 * s3 + 3 * s2) * y1 + (s3 - s2) * h * f1;
+			out(x0 + s * h, y);
+		}
+		out(x1, y1);
+
+		return n;
+	}
+
+	template <class Out>
+	size_t solve_rk4(double x, double y, double x_end, Out& out, size_t& evaluations) const
+	{
+		// One step for every `spacing` pixels along the x axis.
+		double h = (x_end > x ? 1 : -1) * spacing / x_scale;
+		size_t points = 0;
+
+		while (points < max_points && (h > 0 ? x < x_end : x > x_end))
+		{
+			if (fabs(x_end - x) < fabs(h)) h = x_end - x;
+
+			double k1 = f.eval(x, y);
+			double k2 = f.eval(x + h / 2, y + h / 2 * k1);
+			double k3 = f.eval(x + h / 2, y + h / 2 * k2);
+			double k4 = f.eval(x + h, y + h * k3);
+			evaluations += 4;
+
+			x += h;
+			y += h / 6 * (k1 + 2 * k2 + 2 * k3 + k4);
+			if (is_outside(y)) break;
+
+			out(x, y);
+			points++;
+		}
+
+		return points;
+	}
+
+	template <class Out>
+	size_t solve_dormand_prince(double x, double y, double x_end, Out& out, size_t& evaluations) const
+	{
+		double direction = x_end > x ? 1 : -1;
+
+		// The first step is one pixel long, after that the error of every step decides the length of the next one.
+		double h = direction / x_scale;
+		double h_min = fabs(x_end - x) * 1e-12;
+		size_t points = 0;
+
+		// The last stage of a step is evaluated at the start of the next step, so it is only computed once.
+		double k1 = f.eval(x, y);
+		evaluations++;
+
+		while (points < max_points && direction * (x_end - x) > 0)
+		{
+			if (fabs(h) > fabs(x_end - x)) h = x_end - x;
+
+			double k2 = f.eval(x + h / 5, y + h * (k1 / 5));
+			double k3 = f.eval(x + h * 3 / 10, y + h * (k1 * 3 / 40 + k2 * 9 / 40));
+			double k4 = f.eval(x + h * 4 / 5, y + h * (k1 * 44 / 45 - k2 * 56 / 15 + k3 * 32 / 9));
+			double k5 = f.eval(x + h * 8 / 9, y + h * (k1 * 19372 / 6561 - k2 * 25360 / 2187 + k3 * 64448 / 6561 - k4 * 212 / 729));
+			double k6 = f.eval(x + h, y + h * (k1 * 9017 / 3168 - k2 * 355 / 33 + k3 * 46732 / 5247 + k4 * 49 / 176 - k5 * 5103 / 18656));
+			double y_new = y + h * (k1 * 35 / 384 + k3 * 500 / 1113 + k4 * 125 / 192 - k5 * 2187 / 6784 + k6 * 11 / 84);
+			double k7 = f.eval(x + h, y_new);
+			evaluations += 6;
+
+			// The difference between the 5th and 4th order solutions, in pixels.
+			double error = fabs(h * (k1 * 71 / 57600 - k3 * 71 / 16695 + k4 * 71 / 1920 - k5 * 17253 / 339200 + k6 * 22 / 525 - k7 / 40)) * y_scale;
+
+			if (isnan(error) || isnan(y_new))
+			{
+				// f is not defined somewhere in the step. It is retried with a smaller step until the
+				// step gets so small that the solution can't be continued.
+				if (fabs(h) / 4 < h_min) break;
+				h /= 4;
+				continue;
+			}
+
+			// The next step is scaled by how far the error is from the tolerance, but never by more than a factor 5.
+			double factor = error == 0 ? 5 : std::min(5.0, std::max(0.2, 0.9 * pow(tolerance / error, 0.2)));
+
+			// Next to a point where the solution turns vertical on screen the error estimate can't be trusted,
+			// and a step could jump over to another solution. A step where any stage is that steep is therefore
+			// halved, until the solution itself is that steep and can't be continued as a function of x.
+			double steepest = std::max(std::max(fabs(k1), fabs(k2)), std::max(std::max(fabs(k3), fabs(k4)), std::max(std::max(fabs(k5), fabs(k6)), fabs(k7))));
+			if (steepest * y_scale > max_pixel_slope * x_scale)
+			{
+				if (fabs(k1) * y_scale > max_pixel_slope * x_scale || fabs(h) / 2 < h_min) break;
+				h /= 2;
+				continue;
+			}
+
+			// A step has most likely jumped over to another solution, even if its error estimate is small, when
+			// the direction of the solution on screen turns sharply over it, or when the solution is steep and
+			// rises at both ends of the step but falls over the step as a whole (or the other way around).
+			double turn = fabs(atan(k7 * y_scale / x_scale) - atan(k1 * y_scale / x_scale));
+			double pixel_slope = std::min(fabs(k1), fabs(k7)) * y_scale / x_scale;
+			bool backwards = pixel_slope > 1 && (k1 > 0) == (k7 > 0) && (y_new - y) / h * k1 < 0;
+			if (error <= tolerance && (turn > max_turn || backwards))
+			{
+				if (fabs(h) / 2 < h_min) break;
+				h /= 2;
+				continue;
+			}
+
+			if (error <= tolerance)
+			{
+				if (is_outside(y_new)) break;
+
+				points += this->output_step(x, y, k1, x + h, y_new, k7, out);
+				x += h;
+				y = y_new;
+				k1 = k7;
+			}
+			else if (fabs(h) * factor < h_min)
+			{
+				// The solution changes faster than any step can follow, e.g. at a vertical asymptote.
+				break;
+			}
+
+			h *= factor;
+		}
+
+		return points;
+	}
+
+public:
+	// The solution is stopped when y gets further than the height of [y_min, y_max] outside of it.
+	ODESolver(const CompiledExpr& expr, double _x_scale, double _y_scale, double _tolerance, double _spacing, double y_min, double y_max)
+		: f(expr)
+	{
+		x_scale = _x_scale;
+		y_scale = _y_scale;
+		tolerance = _tolerance;
+		spacing = _spacing;
+		y_low = y_min - (y_max - y_min);
+		y_high = y_max + (y_max - y_min);
+	}
+
+	// Integrates from (x0, y0) to x_end, which can also be to the left of x0, and passes the points of the
+	// solution to out(x, y) in order, starting after (x0, y0). Returns the number of evaluations of f.
+	template <class Out>
+	size_t solve(ODEMethod method, double x0, double y0, double x_end, Out out) const
+	{
+		size_t evaluations = 0;
+
+		if (is_outside(y0)) return evaluations;
+
+		if (method == rk4) this->solve_rk4(x0, y0, x_end, out, evaluations);
+		else this->solve_dormand_prince(x0, y0, x_end, out, evaluations);
+
+		return evaluations;
+	}
+};
@@ -0,0 +1,229 @@
+#pragma once
+
+#include <vector>
+#include <algorithm>
+#include <math.h>
+#include "Expression.h"
+
+// A range of pilot intervals that is sampled as one piece of work. `offset` is the index of its first sample.
+struct ParametricChunk
+{
+	size_t begin;
+	size_t end;
+	size_t offset;
+};
+
+// Samples a curve given by a parameter t in [t_min, t_max] with a density that follows its arc length on screen.
+// The t range is first divided into a fixed number of pilot intervals, and the length of every interval in
+// pixels is measured between its end points. Each interval then gets enough samples to keep them about
+// `spacing` pixels apart. Straight and slow parts of the curve thus get few samples, while fast parts are
+// not undersampled.
+// Subclasses define how the points of the curve are computed from t, and call `plan` in their constructor.
+class CurveSampler
+{
+private:
+	double t_min, t_max;
+
+	// Number of samples in every pilot interval, and the index of the first one.
+	std::vector<size_t> counts;
+	std::vector<size_t> offsets;
+
+	static const size_t pilot_intervals = 4096;
+	static const size_t batch_size = 1024;
+
+	double pilot_t(size_t k) const
+	{
+		return t_min + (t_max - t_min) * k / pilot_intervals;
+	}
+
+protected:
+	// Computes the points (xs[i], ys[i]) of the curve for the n parameters ts[i].
+	virtual void eval_points(const double* ts, double* xs, double* ys, size_t n) const = 0;
+
+	// Distributes the samples over the pilot intervals. x_scale and y_scale are the number of pixels per
+	// unit on the axes. The curve gets at most max_points samples.
+	void plan(double _t_min, double _t_max, double x_scale, double y_scale, double spacing, size_t max_points)
+	{
+		// The samples are produced in the order of t, so t has to go upwards.
+		t_min = std::min(_t_min, _t_max);
+		t_max = std::max(_t_min, _t_max);
+
+		std::vector<double> ts(pilot_intervals + 1), xs(pilot_intervals + 1), ys(pilot_intervals + 1);
+		for (size_t k = 0; k <= pilot_intervals; k++)
+		{
+			ts[k] = this->pilot_t(k);
+		}
+		this->eval_points(ts.data(), xs.data(), ys.data(), ts.size());
+
+		counts.resize(pilot_intervals);
+		size_t total = 0;
+		for (size_t k = 0; k < pilot_intervals; k++)
+		{
+			bool start_valid = !isnan(xs[k]) && !isnan(ys[k]);
+			bool end_valid = !isnan(xs[k + 1]) && !isnan(ys[k + 1]);
+
+			if (start_valid && end_valid)
+			{
+				double length = hypot((xs[k + 1] - xs[k]) * x_scale, (ys[k + 1] - ys[k]) * y_scale);
+
+				// Every interval keeps at least its start point, so the curve is never sampled coarser than the pilot.
+				double needed = ceil(length / spacing);
+				counts[k] = needed < 1 ? 1 : needed > max_points ? max_points : (size_t)needed;
+			}
+			else if (start_valid || end_valid)
+			{
+				// The curve ends somewhere inside this interval, so it is sampled densely to find the edge.
+				counts[k] = 64;
+			}
+			else
+			{
+				// The curve is not defined here at all.
+				counts[k] = 1;
+			}
+
+			total += counts[k];
+		}
+
+		// If there would be too many samples, the density is reduced evenly.
+		if (total + 1 > max_points)
+		{
+			double factor = (double)(max_points - 1) / total;
+			for (size_t k = 0; k < pilot_intervals; k++)
+			{
+				size_t scaled = (size_t)(counts[k] * factor);
+				counts[k] = scaled < 1 ? 1 : scaled;
+			}
+		}
+
+		offsets.resize(pilot_intervals + 1);
+		offsets[0] = 0;
+		for (size_t k = 0; k < pilot_intervals; k++)
+		{
+			offsets[k + 1] = offsets[k] + counts[k];
+		}
+	}
+
+public:
+	virtual ~CurveSampler() {}
+
+	// Total number of samples, including the one at t_max.
+	size_t size() const
+	{
+		return offsets.back() + 1;
+	}
+
+	// Splits the pilot intervals into about `count` chunks with a similar number of samples.
+	std::vector<ParametricChunk> chunks(size_t count) const
+	{
+		std::vector<ParametricChunk> result;
+		size_t per_chunk = (this->size() + count - 1) / count;
+		size_t begin = 0;
+
+		while (begin < pilot_intervals)
+		{
+			size_t end = begin + 1;
+			while (end < pilot_intervals && offsets[end] - offsets[begin] < per_chunk)
+			{
+				end++;
+			}
+
+			ParametricChunk chunk = { begin, end, offsets[begin] };
+			result.push_back(chunk);
+			begin = end;
+		}
+
+		return result;
+	}
+
+	// Evaluates the samples of a chunk and passes each of them to out(index, t, x, y).
+	// Chunks can be sampled from several threads at once, as long as `out` writes to separate places.
+	template <class Out>
+	void sample(const ParametricChunk& chunk, Out out) const
+	{
+		std::vector<double> ts(batch_size), xs(batch_size), ys(batch_size);
+		size_t n = 0;
+		size_t index = chunk.offset;
+
+		auto flush = [&]()
+		{
+			this->eval_points(ts.data(), xs.data(), ys.data(), n);
+			for (size_t j = 0; j < n; j++)
+			{
+				out(index + j, ts[j], xs[j], ys[j]);
+			}
+			index += n;
+			n = 0;
+		};
+
+		for (size_t k = chunk.begin; k < chunk.end; k++)
+		{
+			double t0 = this->pilot_t(k);
+			double step = (this->pilot_t(k + 1) - t0) / counts[k];
+
+			for (size_t m = 0; m < counts[k]; m++)
+			{
+				ts[n++] = t0 + m * step;
+				if (n == batch_size) flush();
+			}
+		}
+
+		// The last chunk also closes the curve at t_max.
+		if (chunk.end == pilot_intervals)
+		{
+			ts[n++] = t_max;
+			if (n == batch_size) flush();
+		}
+
+		if (n > 0) flush();
+	}
+};
+
+// The curve (x(t), y(t)) given by two expressions in t.
+class ParametricCurve : public CurveSampler
+{
+private:
+	const CompiledExpr& fx;
+	const CompiledExpr& fy;
+
+protected:
+	void eval_points(const double* ts, double* xs, double* ys, size_t n) const
+	{
+		fx.eval_batch(ts, ts, xs, n);
+		fy.eval_batch(ts, ts, ys, n);
+	}
+
+public:
+	ParametricCurve(const CompiledExpr& _fx, const CompiledExpr& _fy, double t_min, double t_max, double x_scale, double y_scale, double spacing, size_t max_points)
+		: fx(_fx), fy(_fy)
+	{
+		this->plan(t_min, t_max, x_scale, y_scale, spacing, max_points);
+	}
+};
+
+// The polar curve r(theta), with theta as the parameter. Since the samples follow the arc length on screen,
+// outer loops get as many samples as they need and inner loops don't get more than they need.
+class PolarCurve : public CurveSampler
+{
+private:
+	const CompiledExpr& fr;
+
+protected:
+	void eval_points(const double* ts, double* xs, double* ys, size_t n) const
+	{
+		// The radii are evaluated in one batch into xs first and then converted to points in place.
+		fr.eval_batch(ts, ts, xs, n);
+		for (size_t j = 0; j < n; j++)
+		{
+			double r = xs[j];
+			xs[j] = r * cos(ts[j]);
+			ys[j] = r * sin(ts[j]);
+		}
+	}
+
+public:
+	PolarCurve(const CompiledExpr& _fr, double theta_min, double theta_max, double x_scale, double y_scale, double spacing, size_t max_points)
+		: fr(_fr)
+	{
+		this->plan(theta_min, theta_max, x_scale, y_scale, spacing, max_points);
+	}
+};
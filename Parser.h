@@ -9,6 +9,12 @@
 #include <cctype>
 #include <exception>
 #include <algorithm>
+#include <atomic>
+#include <new>
+#include <utility>
+#include <type_traits>
+#include <cstdlib>
+#include <cstdint>
 #include <math.h>
 #include "Matrix_NxN.h"
 
@@ -33,20 +39,13 @@ enum TokenKind {
 	pow_op,		// ^
 	num,		// Number of any length
 	function,	// sqrt, cos, sin etc.
-	variable,	// x
-	vec,		// A fully treated vector [x,y]. x and y are guaranteed to be single numbers.
-	mat,		// A fully treated matrix [[x1, y1],[x2,y2]]. Same rule as above.
+	variable,	// x, y, t, theta or a name the user has defined as a number
+	vec,		// A vector [x,y]. In the expression tree, x and y are its arguments.
+	mat,		// A matrix [[x1, y1],[x2,y2]]. In the expression tree, its columns are its arguments.
 	unknown,	// Everything else
 	end,		// Terminate expression
 };
 
-const std::vector<std::vector<TokenKind>> OP_PRECEDENCE = {
-	{TokenKind::function}, // In a case of e.g. cos(x)^y, cos(x) shall be evaluated first. Not (x)^y.
-	{TokenKind::pow_op},
-	{TokenKind::mul_op, TokenKind::div_op},
-	{TokenKind::add_op, TokenKind::sub_op},
-};
-
 struct Token {
 public:
 	std::string value;
@@ -61,13 +60,13 @@ public:
 	Token() {};
 };
 
-Token make_token(std::string val, TokenKind typ)
+inline Token make_token(std::string val, TokenKind typ)
 {
 	Token tok(val, typ);
 	return tok;
 }
 
-std::string stringify(char c)
+inline std::string stringify(char c)
 {
 	std::string str(1, c);
 	return str;
@@ -79,9 +78,50 @@ constexpr unsigned int str_to_int(const char* str, int h = 0)
 	return !str[h] ? 5381 : (str_to_int(str, h + 1) * 33) ^ str[h];
 }
 
+// Converts the value of a number token, like "12.5", to a double. The digits are read into an integer and
+// divided by a power of ten. Both are exact as long as there are at most 15 digits, so the result is
+// correctly rounded without going through a stringstream. Longer numbers still use one.
+inline double str_to_num(const std::string& str)
+{
+	static const double powers_of_ten[] = { 1e0, 1e1, 1e2, 1e3, 1e4, 1e5, 1e6, 1e7, 1e8, 1e9, 1e10, 1e11, 1e12, 1e13, 1e14, 1e15 };
+
+	long long digits = 0;
+	int num_digits = 0;
+	int decimals = 0;
+	bool after_point = false;
+
+	for (char c : str)
+	{
+		if (c == '.')
+		{
+			// Like a stringstream, the number ends at a second period.
+			if (after_point) break;
+			after_point = true;
+			continue;
+		}
+
+		if (num_digits == 15)
+		{
+			std::stringstream num_str(str);
+			double num;
+			num_str >> num;
+
+			return num;
+		}
+
+		digits = digits * 10 + (c - '0');
+		num_digits++;
+		if (after_point) decimals++;
+	}
+
+	return digits / powers_of_ten[decimals];
+}
+
 class Tokenizer
 {
 	friend class Parser;
+	friend class CompiledExpr;
+	friend class SymbolTable;
 
 private:
 	std::string inp;
@@ -149,8 +189,7 @@ private:
 
 	parse_number:
 		{
-			std::stringstream num;
-			num << c;
+			std::string num(1, c);
 
 			while (char nc = this->next())
 			{
@@ -160,7 +199,7 @@ private:
 				case '0': case '1': case '2': case '3': case '4':
 				case '5': case '6': case '7': case '8': case '9':
 				case '.':
-					num << nc;
+					num += nc;
 					break;
 
 				default:
@@ -171,44 +210,48 @@ private:
 			}
 
 			after_loop_num:
-				return make_token(num.str(), TokenKind::num);
+				return make_token(num, TokenKind::num);
 		}
 		
 	parse_function:
 		{
-			std::stringstream func;
-			func << c;
+			std::string func_str(1, c);
 
+			// The name ends at the first character that isn't a letter, or at the end of the input.
 			while (char fc = this->next())
 			{
-				if (isalpha(fc))
-				{
-					func << fc;
-				}
-				else
+				if (!isalpha(fc))
 				{
 					this->step_back();
-
-					std::string func_str = func.str();
-
-					// Replace constants such as pi and e with their number value.
-					switch (str_to_int(func_str.c_str()))
-					{
-					case str_to_int("pi"):
-						return make_token(std::to_string(M_PI), TokenKind::num);
-						break;
-
-					case str_to_int("e"):
-						return make_token(std::to_string(M_E), TokenKind::num);
-						break;
-
-					// If the letters don't correspond to a constant, then it is a function such as cos, sin, log etc.
-					default:
-						return make_token(func_str, TokenKind::function);
-						break;
-					}
-					
+					break;
 				}
+
+				func_str += fc;
+			}
+
+			// Replace constants such as pi and e with their number value.
+			switch (str_to_int(func_str.c_str()))
+			{
+			case str_to_int("pi"):
+				return make_token(std::to_string(M_PI), TokenKind::num);
+				break;
+
+			case str_to_int("e"):
+				return make_token(std::to_string(M_E), TokenKind::num);
+				break;
+
+			// y is the second variable of expressions in two variables such as H(x*y).
+			// t is the parameter of parametric curves such as T(cos(t), sin(t)), and theta the angle of polar curves.
+			case str_to_int("y"):
+			case str_to_int("t"):
+			case str_to_int("theta"):
+				return make_token(func_str, TokenKind::variable);
+				break;
+
+			// If the letters don't correspond to a constant, then it is a function such as cos, sin, log etc.
+			default:
+				return make_token(func_str, TokenKind::function);
+				break;
 			}
 		}
 	}
@@ -216,7 +259,9 @@ private:
 	// Parses the input string into tokens.
 	std::vector<Token> tokenize()
 	{
+		// There are never more tokens than characters, so the tokens are stored without growing the vector.
 		std::vector<Token> tokens;
+		tokens.reserve(inp.length());
 
 		Token tok = this->next_token();
 
@@ -244,716 +289,522 @@ public:
 	}
 };
 
-class InfixTree
+// Memory for the structures of one parse. Objects are placed one after another in big blocks, which are
+// all freed at once when the arena is destroyed. When the first block is big enough for the whole parse,
+// the tree takes a single block no matter how many nodes it has. The tokens and their strings are
+// allocated separately and aren't part of the arena. Since objects are never
+// freed on their own, only objects that don't need their destructor to run can be made here.
+class ParseArena
 {
-public:
-	Token op;
-	InfixTree* arg1;
-	InfixTree* arg2;
-
-	InfixTree(Token _op)
+private:
+	struct Block
 	{
-		op = _op;
-		arg1 = NULL;
-		arg2 = NULL;
-	}
+		Block* prev;
+		size_t size;
+	};
 
-	void set_arg1(InfixTree* _arg1)
-	{
-		arg1 = _arg1;
-	}
+	Block* last = NULL;
+	char* ptr = NULL;
+	char* end = NULL;
+	size_t next_size;
 
-	void set_arg2(InfixTree* _arg2)
-	{
-		arg2 = _arg2;
-	}
+	size_t num_blocks = 0;
+	size_t num_objects = 0;
 
-	void print()
+	// Counts the blocks of all arenas, so it can be checked that every block that was allocated is also freed.
+	static std::atomic<size_t>& blocks_allocated_counter()
 	{
-		std::cout << "Op: " << op.value << std::endl;
-		std::cout << "Arg 1: " << (arg1 == NULL ? "NULL" : arg1->op.value) << std::endl;
-		std::cout << "Arg 2: " << (arg2 == NULL ? "NULL" : arg2->op.value) << std::endl;
+		static std::atomic<size_t> counter(0);
+		return counter;
 	}
-};
 
-bool is_in_vec(std::vector<TokenKind> v, TokenKind val)
-{
-	return std::find(v.begin(), v.end(), val) != v.end();
-}
-
-class Evaluator
-{
-private:
-	std::vector<Token> tokens;
-	size_t i = 0;
-	size_t op_prec_row = 3;
-
-	Token next_token()
+	static std::atomic<size_t>& blocks_freed_counter()
 	{
-		return i < tokens.size() && i >= 0 ? tokens[i++] : make_token("", TokenKind::end);
+		static std::atomic<size_t> counter(0);
+		return counter;
 	}
 
-	Token previous_token()
+	static char* align_up(char* p, size_t align)
 	{
-		// Subtract two because next_token() advances AFTER retrieving value at index.
-		return tokens[i - 2];
+		return (char*)(((uintptr_t)p + align - 1) & ~(uintptr_t)(align - 1));
 	}
 
-	void step_back()
+	// Adds a block of at least `min_size` bytes. Every block is twice as big as the one before.
+	void add_block(size_t min_size)
 	{
-		i--;
-	}
+		size_t size = std::max(next_size, min_size);
+		Block* block = (Block*)malloc(sizeof(Block) + size);
+		if (block == NULL) throw std::bad_alloc();
 
-	void reset_walker()
-	{
-		i = 0;
+		block->prev = last;
+		block->size = size;
+		last = block;
+		ptr = (char*)(block + 1);
+		end = ptr + size;
+		next_size = size * 2;
+
+		num_blocks++;
+		blocks_allocated_counter()++;
 	}
 
-	void move_walker_to(size_t index)
+public:
+	// The first block is allocated when the first object is made, with room for `initial_size` bytes.
+	ParseArena(size_t initial_size = 4096)
 	{
-		i = index;
+		next_size = initial_size;
 	}
 
-	void advance_operator_precedence()
+	~ParseArena()
 	{
-		op_prec_row++;
+		while (last != NULL)
+		{
+			Block* prev = last->prev;
+			free(last);
+			last = prev;
+			blocks_freed_counter()++;
+		}
 	}
 
-    // In the case of the token list: {"5.6", "+", "7.5"}, this function saves the left and right argument to the node tree
-	void add_2_args_to_node(InfixTree* node)
+	ParseArena(const ParseArena&) = delete;
+	ParseArena& operator=(const ParseArena&) = delete;
+
+	// Constructs an object of type T in the arena.
+	template <class T, class... Args>
+	T* make(Args&&... args)
 	{
-		if (i > 1)
+		static_assert(std::is_trivially_destructible<T>::value, "The destructors of objects in a ParseArena are never called");
+
+		char* p = align_up(ptr, alignof(T));
+		if (ptr == NULL || p + sizeof(T) > end)
 		{
-			Token prv = this->previous_token();
-			InfixTree* arg_left = prv.type == TokenKind::num || prv.type == TokenKind::vec || prv.type == TokenKind::mat
-				? new InfixTree(prv) : NULL;
-			node->set_arg1(arg_left);
+			this->add_block(sizeof(T) + alignof(T));
+			p = align_up(ptr, alignof(T));
 		}
-		
-		Token nxt = this->next_token();
-		InfixTree* arg_right = nxt.type == TokenKind::p_start ?
-			new InfixTree(make_token(std::to_string(this->eval_p_group()), TokenKind::num)) :
-			new InfixTree(nxt);
+		ptr = p + sizeof(T);
 
-		this->step_back();
-
-		if (arg_right->op.type == TokenKind::end) throw MisplacedOperator();
-		
-		node->set_arg2(arg_right);
+		num_objects++;
+		return new (p) T(std::forward<Args>(args)...);
 	}
 
-	// Assumes that the string is a correct number and doesn't contain any invalid characters!
-	double str_to_num(std::string str)
+	// The number of blocks this arena has allocated.
+	size_t blocks() const
 	{
-		std::stringstream num_str(str);
-		double num;
-		num_str >> num;
-
-		return num;
+		return num_blocks;
 	}
 
-	Vector_N<2> str_to_vec(std::string str)
+	size_t objects() const
 	{
-		double x, y;
-		sscanf_s(str.c_str(), "[%lf,%lf]", &x, &y);
-		double varr[2] = { x, y };
-		Vector_N<2> res_vec(varr);
-
-		return res_vec;
+		return num_objects;
 	}
 
-	std::string vec_to_str(Vector_N<2> vec)
+	// The number of arena blocks all arenas have allocated and freed so far. Only arena blocks are counted,
+	// not every allocation a parse makes.
+	static size_t total_arena_blocks_allocated()
 	{
-		std::stringstream ss;
-		ss << '[' << vec.get_x() << ',' << vec.get_y() << ']';
-		return ss.str();
+		return blocks_allocated_counter();
 	}
 
-	Matrix_NxN<2, 2> str_to_mat(std::string str)
+	static size_t total_arena_blocks_freed()
 	{
-		double x1, y1, x2, y2;
-		sscanf_s(str.c_str(), "[[%lf,%lf],[%lf,%lf]]", &x1, &y1, &x2, &y2);
-
-		double marr[2][2] = {
-			{ x1, x2 },
-			{ y1, y2 }
-		};
-		Matrix_NxN<2, 2> res_mat(marr);
-
-		return res_mat;
+		return blocks_freed_counter();
 	}
+};
+
+// A node of the expression tree built by `InfixParser`. The nodes live in a `ParseArena`, and `op` points
+// to the token of the node, so the tree is only valid as long as both the arena and the tokens are.
+// Binary operators have their left argument in arg1 and their right argument in arg2. Functions and unary
+// minus only have arg2, and arg1 is NULL, just as if the missing left argument was 0.
+// Vectors have their x and y in arg1 and arg2, and matrices their first and second column.
+// Numbers and variables are leaves. Numbers are converted once while parsing and stored in num.
+class InfixTree
+{
+public:
+	const Token* op;
+	double num;
+	InfixTree* arg1;
+	InfixTree* arg2;
 
-	std::string mat_to_str(Matrix_NxN<2, 2> mat)
+	InfixTree(const Token* _op, InfixTree* _arg1, InfixTree* _arg2)
 	{
-		std::stringstream ss;
-		ss << "[[" << mat.mat[0][0] << ',' << mat.mat[1][0]
-			<< "],[" <<  mat.mat[0][1] << ',' << mat.mat[1][1] << "]]";
-		return ss.str();
+		op = _op;
+		num = _op->type == TokenKind::num ? str_to_num(_op->value) : 0.0;
+		arg1 = _arg1;
+		arg2 = _arg2;
 	}
 
-    // Evaluates a full parenthesis group and returns the result of it.
-	double eval_p_group()
+	void print()
 	{
-		int depth = 1;
-		std::vector<Token> p_group;
+		std::cout << "Op: " << op->value << std::endl;
+		std::cout << "Arg 1: " << (arg1 == NULL ? "NULL" : arg1->op->value) << std::endl;
+		std::cout << "Arg 2: " << (arg2 == NULL ? "NULL" : arg2->op->value) << std::endl;
+	}
+};
 
-		for (int j = i; i < this->tokens.size(); j++)
-		{
-			Token g_tok = this->next_token();
+// Builds the expression tree of a list of tokens in a single pass with precedence climbing. Every token is
+// looked at once, and parentheses are handled by recursion, so the time is linear in the number of tokens.
+// The nodes are made in the arena, which has to outlive the tree.
+//
+// Operators of the same precedence are evaluated from left to right, also ^. Unary minus binds weaker
+// than ^, so -x^2 is -(x^2). A function is applied to the number, variable or parenthesis right after it,
+// so cos(x)^2 is (cos(x))^2.
+class InfixParser
+{
+private:
+	const std::vector<Token>& tokens;
+	ParseArena& arena;
+	size_t i = 0;
 
-			if (g_tok.type == TokenKind::p_start) depth++;
-			else if (g_tok.type == TokenKind::p_end) depth--;
+	static const int pow_precedence = 3;
 
-			if (depth == 0)
-			{
-				break;
-			}
-
-			p_group.push_back(g_tok);
+	// The precedence of binary operators, or 0 if the token isn't one.
+	static int precedence(TokenKind type)
+	{
+		switch (type)
+		{
+		case TokenKind::add_op: case TokenKind::sub_op: return 1;
+		case TokenKind::mul_op: case TokenKind::div_op: return 2;
+		case TokenKind::pow_op: return pow_precedence;
+		default: return 0;
 		}
-
-		Evaluator evaluator(p_group);
-		double p_eval = evaluator.eval();
-
-		return p_eval;
 	}
 
-    // Receives a lambda function that treats the node's arguments
-	template<typename F>
-	double calculate_result(InfixTree* node, F lambda)
+	// The tokens of vector and matrix nodes, which don't have a token of their own in the input.
+	static const Token* vec_token()
 	{
-		double num1 = node->arg1 == NULL ? 0.0 : this->str_to_num(node->arg1->op.value);
-		double num2 = node->arg2 == NULL ? 0.0 : this->str_to_num(node->arg2->op.value);
-
-		return lambda(num1, num2);
+		static const Token tok("[]", TokenKind::vec);
+		return &tok;
 	}
-	
-	void replace_tokens_with_result(double res, size_t s, size_t e)
+
+	static const Token* mat_token()
 	{
-		tokens.erase(tokens.begin() + s, tokens.begin() + e);
-		tokens.insert(tokens.begin() + s, make_token(std::to_string(res), TokenKind::num));
+		static const Token tok("[[]]", TokenKind::mat);
+		return &tok;
 	}
 
-	void replace_tokens_with_token(Token tok, size_t s, size_t e)
+	const Token& peek()
 	{
-		tokens.erase(tokens.begin() + s, tokens.begin() + e);
-		tokens.insert(tokens.begin() + s, tok);
+		static const Token end_token("", TokenKind::end);
+		return i < tokens.size() ? tokens[i] : end_token;
 	}
 
-	double eval_vec_entry()
+	void expect(TokenKind type)
 	{
-		std::vector<Token> vec_entry;
-
-		for (int j = i; i < this->tokens.size(); j++)
+		if (this->peek().type != type)
 		{
-			Token g_tok = this->next_token();
-
-			if (g_tok.type == TokenKind::v_sep || g_tok.type == TokenKind::v_end)
-			{
-				break;
-			}
-
-			vec_entry.push_back(g_tok);
+			if (type == TokenKind::p_end) throw InvalidParentheses();
+			throw InvalidMatrixOrVector();
 		}
-
-		Evaluator evaluator(vec_entry);
-		double p_eval = evaluator.eval();
-
-		return p_eval;
+		i++;
 	}
 
-public:
-	Evaluator(std::vector<Token> toks)
+	InfixTree* make_node(const Token* op, InfixTree* arg1, InfixTree* arg2)
 	{
-		tokens = toks;
+		return arena.make<InfixTree>(op, arg1, arg2);
 	}
 
-    // The main evaluator function. Converts a mathematical expression to a single number.
-	double eval()
+	// Parses operators with at least the precedence `min_prec`. Operators of higher precedence are parsed
+	// by the recursive call for the right argument, so they end up further down in the tree.
+	InfixTree* parse_expr(int min_prec)
 	{
-		for (std::vector<TokenKind> cur_ops : OP_PRECEDENCE)
-		{
-			Token tok = this->next_token();
-
-			while (tok.type != TokenKind::end)
-			{
-				InfixTree* node = new InfixTree(tok);
-
-				switch (tok.type)
-				{
-				case TokenKind::p_start:
-				{
-					size_t s = i - 1;
-					double res = this->eval_p_group();
-					size_t e = i;
-
-					this->replace_tokens_with_result(res, s, e);
-					this->move_walker_to(s);
-				}
-				break;
-
-				case TokenKind::mul_op:
-					if (is_in_vec(cur_ops, TokenKind::mul_op))
-					{
-						size_t s = i - 2;
-						this->add_2_args_to_node(node);
-						size_t e = i;
-
-						double prod = this->calculate_result(node,
-							[](double num1, double num2) { return num1 * num2; });
-						this->replace_tokens_with_result(prod, s, e + 1);
-						this->move_walker_to(s);
-					}
-					break;
-
-				case TokenKind::div_op:
-					if (is_in_vec(cur_ops, TokenKind::mul_op))
-					{
-						size_t s = i - 2;
-						this->add_2_args_to_node(node);
-						size_t e = i;
-
-						double prod = this->calculate_result(node,
-							[](double num1, double num2) { return num1 / num2; });
-						this->replace_tokens_with_result(prod, s, e + 1);
-						this->move_walker_to(s);
-					}
-					break;
-
-				case TokenKind::add_op:
-					if (is_in_vec(cur_ops, TokenKind::add_op))
-					{
-						size_t s = i - 2;
-						this->add_2_args_to_node(node);
-						size_t e = i;
-
-						double sum = this->calculate_result(node,
-							[](double num1, double num2) { return num1 + num2; });
-						this->replace_tokens_with_result(sum, s, e + 1);
-						this->move_walker_to(s);
-					}
-					break;
+		InfixTree* left = this->parse_unary();
 
-				case TokenKind::sub_op:
-					if (is_in_vec(cur_ops, TokenKind::sub_op))
-					{
-						size_t s = i - 2;
-						this->add_2_args_to_node(node);
-						size_t e = i;
-
-						double sum = this->calculate_result(node,
-							[](double num1, double num2) { return num1 - num2; });
-						this->replace_tokens_with_result(sum, s, e + 1);
-						this->move_walker_to(s);
-					}
-					break;
+		while (true)
+		{
+			const Token& op = this->peek();
+			int prec = precedence(op.type);
+			if (prec == 0 || prec < min_prec) break;
 
-				case TokenKind::pow_op:
-					if (is_in_vec(cur_ops, TokenKind::pow_op))
-					{
-						size_t s = i - 2;
-						this->add_2_args_to_node(node);
-						size_t e = i;
-
-						double sum = this->calculate_result(node,
-							[](double num1, double num2) { return pow(num1, num2); });
-						this->replace_tokens_with_result(sum, s, e + 1);
-						this->move_walker_to(s);
-					}
-					break;
+			i++;
 
-				case TokenKind::function:
-					if (is_in_vec(cur_ops, TokenKind::function))
-					{
-						size_t s = i - 1;
-						this->add_2_args_to_node(node);
-						size_t e = i;
-
-						double func_res;
-
-						switch (str_to_int(tok.value.c_str()))
-						{
-						case str_to_int("cos"):
-							func_res = this->calculate_result(node,
-								[](double num1, double num2) { return cos(num2); });
-							break;
-
-						case str_to_int("sin"):
-							func_res = this->calculate_result(node,
-								[](double num1, double num2) { return sin(num2); });
-							break;
-
-						case str_to_int("tan"):
-							func_res = this->calculate_result(node,
-								[](double num1, double num2) { return tan(num2); });
-							break;
-
-						case str_to_int("sqrt"):
-							func_res = this->calculate_result(node,
-								[](double num1, double num2) { return sqrt(num2); });
-							break;
-
-						// log as defined by math.h is the natural logarithm. We will stick to log being log10.
-						case str_to_int("ln"):
-							func_res = this->calculate_result(node,
-								[](double num1, double num2) { return log(num2); });
-							break;
-
-						case str_to_int("log"):
-							func_res = this->calculate_result(node,
-								[](double num1, double num2) { return log10(num2); });
-							break;
-
-						default:
-							throw InvalidFunction();
-							break;
-						}
-						 
-						this->replace_tokens_with_result(func_res, s, e + 1);
-						this->move_walker_to(s);
-					}
-					break;
-
-				default:
-					break;
-				}
+			// The right argument only takes operators that bind tighter, which makes the operators left-associative.
+			InfixTree* right = this->parse_expr(prec + 1);
+			left = this->make_node(&op, left, right);
+		}
 
-				tok = this->next_token();
+		return left;
+	}
 
-				// We created the InfixTree* node pointer using the `new` keyword, making sure it was
-				// stored on the heap. Thus we also need to delete it ourselves to avoid leaking memory:
-				delete node->arg1;
-				delete node->arg2;
-				delete node;
-			}
+	InfixTree* parse_unary()
+	{
+		const Token& tok = this->peek();
 
-			this->reset_walker();
+		if (tok.type == TokenKind::sub_op)
+		{
+			i++;
+			InfixTree* arg = this->parse_expr(pow_precedence);
+			return this->make_node(&tok, NULL, arg);
 		}
 
-		// If everything went according to plan, we should only have 1 single token of type num left.
-		Token result = this->next_token();
-		if (tokens.size() != 1 || result.type != TokenKind::num)
+		// A plus in front of an operand doesn't do anything
+		if (tok.type == TokenKind::add_op)
 		{
-			throw UnsuccesfulCalculation();
+			i++;
+			return this->parse_unary();
 		}
 
-		return str_to_num(result.value);
+		return this->parse_primary();
 	}
 
-    // Evaluates a math expression that results in a vector
-	Vector_N<2> eval_vec()
+	InfixTree* parse_primary()
 	{
-		Token tok = this->next_token();
+		const Token& tok = this->peek();
 
-		// Go through everything and evaluate the contents of vectors and matrices.
-		while (tok.type != TokenKind::end)
+		switch (tok.type)
 		{
-			switch (tok.type)
-			{
-			case TokenKind::v_start:
-			case TokenKind::v_sep:
-			{
-				Token nxt = this->next_token();
-				if (nxt.type == TokenKind::v_start)
-				{
-					tok = nxt;
-				}
-				else
-				{
-					this->step_back();
-				}
-
-				size_t s = i - 1;
-				double res = this->eval_vec_entry();
-				size_t e = i;
-
-				this->replace_tokens_with_result(res, s + 1, e - 1);
-				this->move_walker_to(s + 1);
-			}
-				break;
+		case TokenKind::num:
+		case TokenKind::variable:
+			i++;
+			return this->make_node(&tok, NULL, NULL);
 
-			default:
-				break;
-			}
-
-			tok = this->next_token();
+		case TokenKind::p_start:
+		{
+			i++;
+			InfixTree* inner = this->parse_expr(1);
+			this->expect(TokenKind::p_end);
+			return inner;
 		}
 
-		this->reset_walker();
-		tok = this->next_token();
-
-		// Go through again and convert vectors that are now split into multiple tokens into a single token.
-		while (tok.type != TokenKind::end)
+		case TokenKind::function:
 		{
-			switch (tok.type)
-			{
-			case TokenKind::v_start:
-			{
-				// Jump to the next token. If it is a vec start too, we simply start evaluating from there.
-				Token nxt = this->next_token();
-				if (nxt.type == TokenKind::v_start)
-				{
-					tok = nxt;
-				}
-				else
-				{
-					this->step_back();
-				}
-
-				size_t s = i - 1;
+			i++;
+			InfixTree* arg = this->parse_unary();
+			return this->make_node(&tok, NULL, arg);
+		}
 
-				std::stringstream vec;
-				vec << tok.value;
+		case TokenKind::v_start:
+			i++;
+			return this->parse_vector_or_matrix();
 
-				Token tmp_tok = this->next_token();
+		case TokenKind::p_end:
+			throw InvalidParentheses();
 
-				while (tmp_tok.type != TokenKind::end)
-				{
-					vec << tmp_tok.value;
-
-					if (tmp_tok.type == TokenKind::v_end)
-					{
-						break;
-					}
+		default:
+			throw MisplacedOperator();
+		}
+	}
 
-					tmp_tok = this->next_token();
-				}
+	// Parses [x, y] or [[x1, y1], [x2, y2]] after the first [.
+	InfixTree* parse_vector_or_matrix()
+	{
+		bool is_matrix = this->peek().type == TokenKind::v_start;
+		if (is_matrix) i++;
 
-				Token vec_tok = make_token(vec.str(), TokenKind::vec);
+		InfixTree* first = this->parse_expr(1);
+		this->expect(TokenKind::v_sep);
+		InfixTree* second = this->parse_expr(1);
+		this->expect(TokenKind::v_end);
+		InfixTree* column = this->make_node(vec_token(), first, second);
 
-				size_t e = i;
+		if (!is_matrix) return column;
 
-				this->replace_tokens_with_token(vec_tok, s, e);
-				this->move_walker_to(s + 1);
-			}
-			break;
+		this->expect(TokenKind::v_sep);
+		this->expect(TokenKind::v_start);
+		InfixTree* third = this->parse_expr(1);
+		this->expect(TokenKind::v_sep);
+		InfixTree* fourth = this->parse_expr(1);
+		this->expect(TokenKind::v_end);
+		this->expect(TokenKind::v_end);
+		InfixTree* column2 = this->make_node(vec_token(), third, fourth);
 
-			default:
-				break;
-			}
+		return this->make_node(mat_token(), column, column2);
+	}
 
-			tok = this->next_token();
-		}
+public:
+	InfixParser(const std::vector<Token>& toks, ParseArena& _arena) : tokens(toks), arena(_arena) {}
 
-		this->reset_walker();
-		tok = this->next_token();
+	// The number of bytes an arena needs to hold the tree of `num_tokens` tokens in one block. There is at
+	// most one node per token, since parentheses and separators don't get a node.
+	static size_t arena_size(size_t num_tokens)
+	{
+		return (num_tokens + 1) * sizeof(InfixTree) + alignof(InfixTree);
+	}
 
-		// Go through again and construct potential matrices
-		while (tok.type != TokenKind::end)
-		{
-			switch (tok.type)
-			{
-			case TokenKind::v_start:
-			{
-				size_t s = i - 1;
+	// Parses all the tokens into one tree.
+	InfixTree* parse()
+	{
+		InfixTree* root = this->parse_expr(1);
 
-				std::stringstream mat;
-				mat << tok.value;
+		// Everything has to be part of the expression
+		if (this->peek().type == TokenKind::p_end) throw InvalidParentheses();
+		if (this->peek().type != TokenKind::end) throw MisplacedOperator();
 
-				Token tmp_tok = this->next_token();
+		return root;
+	}
+};
 
-				while (tmp_tok.type != TokenKind::end)
-				{
-					mat << tmp_tok.value;
+// Evaluates expressions without variables, whose result is a number or a vector.
+class Evaluator
+{
+private:
+	const std::vector<Token>& tokens;
 
-					if (tmp_tok.type == TokenKind::v_end)
-					{
-						break;
-					}
+	// The value of a part of the expression, which is a number, a vector or a matrix.
+	struct Value
+	{
+		TokenKind type;
+		double num;
+		Matrix_NxN<2, 1> vec;
+		Matrix_NxN<2, 2> mat;
+	};
 
-					tmp_tok = this->next_token();
-				}
+	static Value make_num(double num)
+	{
+		Value val;
+		val.type = TokenKind::num;
+		val.num = num;
+		return val;
+	}
 
-				Token mat_tok = make_token(mat.str(), TokenKind::mat);
+	static Value make_vec(Matrix_NxN<2, 1> vec)
+	{
+		Value val;
+		val.type = TokenKind::vec;
+		val.vec = vec;
+		return val;
+	}
 
-				size_t e = i;
+	static Value make_mat(Matrix_NxN<2, 2> mat)
+	{
+		Value val;
+		val.type = TokenKind::mat;
+		val.mat = mat;
+		return val;
+	}
 
-				this->replace_tokens_with_token(mat_tok, s, e);
-				this->move_walker_to(s + 1);
-			}
-			break;
+	static double apply_function(const std::string& name, double arg)
+	{
+		switch (str_to_int(name.c_str()))
+		{
+		case str_to_int("cos"): return cos(arg);
+		case str_to_int("sin"): return sin(arg);
+		case str_to_int("tan"): return tan(arg);
+		case str_to_int("sqrt"): return sqrt(arg);
+		// log as defined by math.h is the natural logarithm. We will stick to log being log10.
+		case str_to_int("ln"): return log(arg);
+		case str_to_int("log"): return log10(arg);
+		default: throw InvalidFunction();
+		}
+	}
 
-			default:
-				break;
-			}
+	// Evaluates a tree whose value is a number. This is the common case, so it doesn't go through `Value`.
+	static double eval_num(const InfixTree* node)
+	{
+		switch (node->op->type)
+		{
+		case TokenKind::num: return node->num;
+		case TokenKind::function: return apply_function(node->op->value, eval_num(node->arg2));
+		case TokenKind::add_op: return eval_num(node->arg1) + eval_num(node->arg2);
+		case TokenKind::sub_op: return (node->arg1 == NULL ? 0.0 : eval_num(node->arg1)) - eval_num(node->arg2);
+		case TokenKind::mul_op: return eval_num(node->arg1) * eval_num(node->arg2);
+		case TokenKind::div_op: return eval_num(node->arg1) / eval_num(node->arg2);
+		case TokenKind::pow_op: return pow(eval_num(node->arg1), eval_num(node->arg2));
+
+		// Variables, vectors and matrices don't have a number value
+		default: throw UnsuccesfulCalculation();
+		}
+	}
 
-			tok = this->next_token();
+	static Value eval_value(const InfixTree* node)
+	{
+		switch (node->op->type)
+		{
+		case TokenKind::vec:
+		{
+			Matrix_NxN<2, 1> vec;
+			vec.mat[0][0] = eval_num(node->arg1);
+			vec.mat[1][0] = eval_num(node->arg2);
+			return make_vec(vec);
 		}
 
-		// Finally, do all the arithmetic
-		this->reset_walker();
-		tok = this->next_token();
+		case TokenKind::mat:
+		{
+			// The vectors inside a matrix are its columns
+			Value col1 = eval_value(node->arg1);
+			Value col2 = eval_value(node->arg2);
+			Matrix_NxN<2, 2> mat;
+			mat.mat[0][0] = col1.vec.mat[0][0];
+			mat.mat[1][0] = col1.vec.mat[1][0];
+			mat.mat[0][1] = col2.vec.mat[0][0];
+			mat.mat[1][1] = col2.vec.mat[1][0];
+			return make_mat(mat);
+		}
 
-		for (std::vector<TokenKind> cur_ops : OP_PRECEDENCE)
+		case TokenKind::add_op:
+		case TokenKind::sub_op:
 		{
-			Token tok = this->next_token();
+			Value b = eval_value(node->arg2);
 
-			while (tok.type != TokenKind::end)
+			if (node->arg1 == NULL)
 			{
-				InfixTree* node = new InfixTree(tok);
-
-				switch (tok.type)
-				{
-				case TokenKind::add_op:
-					if (is_in_vec(cur_ops, TokenKind::add_op))
-					{
-						size_t s = i - 2;
-						this->add_2_args_to_node(node);
-						size_t e = i;
-
-						if (node->arg1->op.type == TokenKind::vec)
-						{
-							Vector_N<2> v1 = this->str_to_vec(node->arg1->op.value);
-							Vector_N<2> v2 = this->str_to_vec(node->arg2->op.value);
-
-							Vector_N<2> sum = v1.add(v2).to_vec();
-
-							Token res_tok = make_token(this->vec_to_str(sum), TokenKind::vec);
-							this->replace_tokens_with_token(res_tok, s, e + 1);
-						}
-
-						if (node->arg1->op.type == TokenKind::mat)
-						{
-							Matrix_NxN<2, 2> m1 = this->str_to_mat(node->arg1->op.value);
-							Matrix_NxN<2, 2> m2 = this->str_to_mat(node->arg2->op.value);
-
-							Matrix_NxN<2, 2> sum = m1.add(m2);
-
-							Token res_tok = make_token(this->mat_to_str(sum), TokenKind::mat);
-							this->replace_tokens_with_token(res_tok, s, e + 1);
-						}
-						
-						this->move_walker_to(s);
-					}
-					break;
-
-				case TokenKind::sub_op:
-					if (is_in_vec(cur_ops, TokenKind::sub_op))
-					{
-						size_t s = i - 2;
-						this->add_2_args_to_node(node);
-						size_t e = i;
-
-						if (node->arg1->op.type == TokenKind::vec)
-						{
-							Vector_N<2> v1 = this->str_to_vec(node->arg1->op.value);
-							Vector_N<2> v2 = this->str_to_vec(node->arg2->op.value);
-
-							Vector_N<2> sum = v1.subtract(v2).to_vec();
-
-							Token res_tok = make_token(this->vec_to_str(sum), TokenKind::vec);
-							this->replace_tokens_with_token(res_tok, s, e + 1);
-						}
-
-						if (node->arg1->op.type == TokenKind::mat)
-						{
-							Matrix_NxN<2, 2> m1 = this->str_to_mat(node->arg1->op.value);
-							Matrix_NxN<2, 2> m2 = this->str_to_mat(node->arg2->op.value);
-
-							Matrix_NxN<2, 2> sum = m1.subtract(m2);
-
-							Token res_tok = make_token(this->mat_to_str(sum), TokenKind::mat);
-							this->replace_tokens_with_token(res_tok, s, e + 1);
-						}
-						
-						this->move_walker_to(s);
-					}
-					break;
-
-				case TokenKind::mul_op:
-					if (is_in_vec(cur_ops, TokenKind::sub_op))
-					{
-						size_t s = i - 2;
-						this->add_2_args_to_node(node);
-						size_t e = i;
-
-						if (node->arg2->op.type == TokenKind::vec)
-						{
-							if (node->arg1->op.type == TokenKind::vec) throw MustNotMultiplyVectors();
-
-							if (node->arg1->op.type == TokenKind::num)
-							{
-								double n = this->str_to_num(node->arg1->op.value);
-								Vector_N<2> v = this->str_to_vec(node->arg2->op.value);
-
-								Vector_N<2> prod = v.mult(n).to_vec();
-
-								Token res_tok = make_token(this->vec_to_str(prod), TokenKind::vec);
-								this->replace_tokens_with_token(res_tok, s, e + 1);
-							}
-							else if (node->arg1->op.type == TokenKind::mat)
-							{
-								Matrix_NxN<2, 2> m = this->str_to_mat(node->arg1->op.value);
-								Vector_N<2> v = this->str_to_vec(node->arg2->op.value);
-
-								Vector_N<2> prod = m.mult(v).to_vec();
-
-								Token res_tok = make_token(this->vec_to_str(prod), TokenKind::vec);
-								this->replace_tokens_with_token(res_tok, s, e + 1);
-							}
-						}
-
-						if (node->arg1->op.type == TokenKind::mat && node->arg2->op.type == TokenKind::mat)
-						{
-							Matrix_NxN<2, 2> m1 = this->str_to_mat(node->arg1->op.value);
-							Matrix_NxN<2, 2> m2 = this->str_to_mat(node->arg2->op.value);
+				if (b.type == TokenKind::vec) return make_vec(b.vec.mult(-1.0));
+				if (b.type == TokenKind::mat) return make_mat(b.mat.mult(-1.0));
+				return make_num(-b.num);
+			}
 
-							m1.print();
-							m2.print();
+			Value a = eval_value(node->arg1);
+			if (a.type != b.type) throw UnsuccesfulCalculation();
 
-							Matrix_NxN<2, 2> prod = m1.mult(m2);
+			bool add = node->op->type == TokenKind::add_op;
+			if (a.type == TokenKind::vec) return make_vec(add ? a.vec.add(b.vec) : a.vec.subtract(b.vec));
+			if (a.type == TokenKind::mat) return make_mat(add ? a.mat.add(b.mat) : a.mat.subtract(b.mat));
+			return make_num(add ? a.num + b.num : a.num - b.num);
+		}
 
-							Token res_tok = make_token(this->mat_to_str(prod), TokenKind::mat);
-							this->replace_tokens_with_token(res_tok, s, e + 1);
-						}
+		case TokenKind::mul_op:
+		{
+			Value a = eval_value(node->arg1);
+			Value b = eval_value(node->arg2);
 
-						if (node->arg1->op.type == TokenKind::num && node->arg2->op.type == TokenKind::mat)
-						{
-							double n = this->str_to_num(node->arg1->op.value);
-							Matrix_NxN<2, 2> m = this->str_to_mat(node->arg2->op.value);
+			if (a.type == TokenKind::vec && b.type == TokenKind::vec) throw MustNotMultiplyVectors();
 
-							Matrix_NxN<2, 2> prod = m.mult(n);
+			if (a.type == TokenKind::num && b.type == TokenKind::num) return make_num(a.num * b.num);
+			if (a.type == TokenKind::num && b.type == TokenKind::vec) return make_vec(b.vec.mult(a.num));
+			if (a.type == TokenKind::vec && b.type == TokenKind::num) return make_vec(a.vec.mult(b.num));
+			if (a.type == TokenKind::num && b.type == TokenKind::mat) return make_mat(b.mat.mult(a.num));
+			if (a.type == TokenKind::mat && b.type == TokenKind::num) return make_mat(a.mat.mult(b.num));
+			if (a.type == TokenKind::mat && b.type == TokenKind::vec) return make_vec(a.mat.mult(b.vec));
+			if (a.type == TokenKind::mat && b.type == TokenKind::mat) return make_mat(a.mat.mult(b.mat));
 
-							Token res_tok = make_token(this->mat_to_str(prod), TokenKind::mat);
-							this->replace_tokens_with_token(res_tok, s, e + 1);
-						}
+			throw UnsuccesfulCalculation();
+		}
 
-						this->move_walker_to(s);
-					}
-					break;
+		// Everything else is only defined for numbers
+		default:
+			return make_num(eval_num(node));
+		}
+	}
 
-				default:
-					break;
-				}
+public:
+	// The tokens are not copied, so they have to outlive the evaluator.
+	Evaluator(const std::vector<Token>& toks) : tokens(toks) {}
 
-				tok = this->next_token();
+	// The main evaluator function. Converts a mathematical expression to a single number.
+	double eval()
+	{
+		// The tree only lives while it is evaluated, and is freed at once with its arena afterwards.
+		ParseArena arena(InfixParser::arena_size(tokens.size()));
+		InfixParser parser(tokens, arena);
+		return eval_num(parser.parse());
+	}
 
-				// We created the InfixTree* node pointer using the `new` keyword, making sure it was
-				// stored on the heap. Thus we also need to delete it ourselves to avoid leaking memory:
-				delete node->arg1;
-				delete node->arg2;
-				delete node;
-			}
+	// Evaluates a math expression that results in a vector
+	Vector_N<2> eval_vec()
+	{
+		ParseArena arena(InfixParser::arena_size(tokens.size()));
+		InfixParser parser(tokens, arena);
+		Value res = eval_value(parser.parse());
 
-			this->reset_walker();
-		}
-		
-		this->reset_walker();
-		// If everything went according to plan, we should only have 1 single token of type vec left.
-		Token result = this->next_token();
-		if (tokens.size() != 1 || result.type != TokenKind::vec)
+		if (res.type != TokenKind::vec)
 		{
 			throw UnsuccesfulCalculation();
 		}
 
-		Vector_N<2> res_vec = this->str_to_vec(result.value);
-
-		return res_vec;
+		return res.vec.to_vec();
 	}
 
 	void print_toks()
 	{
-		for (Token token : tokens)
+		for (const Token& token : tokens)
 		{
 			std::cout << "<" << token.value << "> ";
 		}
@@ -989,7 +840,7 @@ private:
 	{
 		int p_depth = 0;
 
-		for (Token token : tokens)
+		for (const Token& token : tokens)
 		{
 			if (token.type == TokenKind::p_start) p_depth++;
 			else if (token.type == TokenKind::p_end) p_depth--;
@@ -1002,7 +853,7 @@ private:
 	{
 		int v_depth = 0;
 
-		for (Token token : tokens)
+		for (const Token& token : tokens)
 		{
 			if (token.type == TokenKind::v_start) v_depth++;
 			else if (token.type == TokenKind::v_end) v_depth--;
@@ -1017,7 +868,7 @@ public:
 	Parser(std::string input)
 	{
 		inp = input;
-		tokenizer = *new Tokenizer(input);
+		tokenizer = Tokenizer(input);
 	}
 
 	// Executes the mathematical expression (input string).
@@ -0,0 +1,85 @@
+#pragma once
+
+#include <iostream>
+#include <string>
+#include <vector>
+#include <chrono>
+#include <algorithm>
+#include "Parser.h"
+
+// Generates an expression of at least `num_tokens` tokens, with operators of every precedence, functions,
+// unary minus and nested parentheses, e.g. "1+sin(1.5)*(1-4/(1+6))^2-...". The exact number of tokens is
+// written to count.
+inline std::string generate_benchmark_expr(size_t num_tokens, size_t& count)
+{
+	std::string expr = "1";
+	count = 1;
+	size_t k = 0;
+
+	while (count < num_tokens)
+	{
+		std::string n = std::to_string(k % 9 + 1);
+
+		switch (k % 4)
+		{
+		case 0: expr += "+sin(" + n + ".5)*(" + n + "-4/(" + n + "+6))^2"; count += 19; break;
+		case 1: expr += "-" + n + "*-cos(" + n + ")"; count += 8; break;
+		case 2: expr += "+((" + n + "+1)*(" + n + "-1))/" + n; count += 14; break;
+		case 3: expr += "-sqrt(" + n + "^2+1)*ln(" + n + ")"; count += 13; break;
+		}
+
+		k++;
+	}
+
+	return expr;
+}
+
+// Times tokenizing, parsing and evaluating generated expressions of 10000 tokens and of 2, 4 and 8 times
+// as many, and prints the time per token of each. Since the parser takes linear time, the time per token
+// stays about the same. It also prints how many blocks the parse arena allocated per parse, which should be
+// 1, and checks that all of them were freed again. The token vector and strings of a parse are allocated
+// outside the arena and aren't counted.
+// Returns false if the time per token grows by more than a factor 2 from the smallest to the largest, or if
+// any arena block was leaked.
+inline bool run_parser_benchmark(std::ostream& out)
+{
+	const size_t sizes[] = { 10000, 20000, 40000, 80000 };
+	double first_per_token = 0;
+	double last_per_token = 0;
+
+	for (size_t num_tokens : sizes)
+	{
+		size_t count;
+		std::string expr = generate_benchmark_expr(num_tokens, count);
+
+		// The best of a few runs, so a single hiccup doesn't count
+		double best = 1e300;
+		double result = 0;
+		size_t blocks_before = ParseArena::total_arena_blocks_allocated();
+		for (int run = 0; run < 5; run++)
+		{
+			auto start = std::chrono::steady_clock::now();
+			Parser parser(expr);
+			result = parser.eval_expr_num();
+			auto stop = std::chrono::steady_clock::now();
+
+			best = std::min(best, std::chrono::duration<double>(stop - start).count());
+		}
+
+		double per_token = best / count * 1e9;
+		double blocks_per_parse = (ParseArena::total_arena_blocks_allocated() - blocks_before) / 5.0;
+		if (first_per_token == 0) first_per_token = per_token;
+		last_per_token = per_token;
+
+		out << count << " tokens: " << best * 1e3 << " ms, " << per_token << " ns per token, "
+			<< blocks_per_parse << " arena blocks per parse (result " << result << ")" << std::endl;
+	}
+
+	bool linear = last_per_token < 2 * first_per_token;
+	out << (linear ? "Linear scaling" : "NOT linear scaling") << std::endl;
+
+	bool freed = ParseArena::total_arena_blocks_allocated() == ParseArena::total_arena_blocks_freed();
+	out << ParseArena::total_arena_blocks_allocated() << " arena blocks allocated, " << ParseArena::total_arena_blocks_freed() << " freed" << std::endl;
+
+	return linear && freed;
+}
@@ -0,0 +1,226 @@
+#pragma once
+
+#include <string>
+#include <vector>
+#include <map>
+#include <set>
+#include <sstream>
+#include <iomanip>
+#include <algorithm>
+#include <cctype>
+#include <exception>
+#include "Parser.h"
+#include "Expression.h"
+
+struct InvalidDefinition : public std::exception {};
+
+// The names the user has defined, like a = 2 and g(x) = a*sin(x), and which definitions use which.
+// A definition can use the ones made before it. When it is changed, the definitions that use it, directly or
+// through others, are compiled again, and `define` tells which ones they are, so only the plots that use
+// one of them have to be drawn again.
+class SymbolTable
+{
+private:
+	struct Definition
+	{
+		std::string param; // Empty for numbers
+		std::string body;
+		std::set<std::string> uses;
+	};
+
+	std::map<std::string, Definition> definitions;
+	SymbolMap symbols;
+
+	// Whether `name` uses `target`, directly or through other definitions. The names in `visited` have been
+	// searched already, and don't use it, so every definition is only searched once.
+	bool depends_on(const std::string& name, const std::string& target, std::set<std::string>& visited) const
+	{
+		if (!visited.insert(name).second) return false;
+
+		auto def = definitions.find(name);
+		if (def == definitions.end()) return false;
+
+		for (const std::string& used : def->second.uses)
+		{
+			if (used == target || this->depends_on(used, target, visited)) return true;
+		}
+
+		return false;
+	}
+
+	// Adds the definitions that use `name` to `order` after all the definitions they use themselves, by
+	// visiting them depth first and reversing the order afterwards.
+	void add_dependents(const std::string& name, std::set<std::string>& visited, std::vector<std::string>& order) const
+	{
+		if (!visited.insert(name).second) return;
+
+		for (const auto& def : definitions)
+		{
+			if (def.second.uses.count(name)) this->add_dependents(def.first, visited, order);
+		}
+
+		order.push_back(name);
+	}
+
+	// Compiles the body of a definition with the current meaning of the names it uses.
+	Symbol compile_definition(const Definition& def) const
+	{
+		CompiledExpr expr(def.body, &symbols);
+
+		Symbol symbol;
+		symbol.is_function = !def.param.empty();
+		symbol.value = symbol.is_function ? 0.0 : expr.eval(0);
+		symbol.program = expr.program;
+		symbol.bindings = expr.bindings;
+
+		// A number can't depend on x or y
+		if (!symbol.is_function)
+		{
+			for (const Instruction& instr : expr.program)
+			{
+				if (instr.op == op_x || instr.op == op_y) throw InvalidDefinition();
+			}
+		}
+
+		if (!symbol.is_function && !isfinite(symbol.value)) throw InvalidDefinition();
+
+		return symbol;
+	}
+
+	// Changes the definition of `name`, where `symbol` is its new meaning if that is already known, and compiles
+	// the definitions that depend on it again. Returns the names whose meaning changed, and changes nothing if
+	// one of them can't be compiled anymore.
+	std::vector<std::string> replace(const std::string& name, const Definition& def, const Symbol* symbol)
+	{
+		std::vector<std::string> changed = this->dependents(name);
+
+		// The old meanings are kept until all definitions have been compiled again
+		std::map<std::string, Definition> old_definitions;
+		std::map<std::string, Symbol> old_symbols;
+		for (const std::string& changed_name : changed)
+		{
+			if (definitions.count(changed_name))
+			{
+				old_definitions[changed_name] = definitions[changed_name];
+				old_symbols[changed_name] = symbols[changed_name];
+			}
+		}
+
+		try
+		{
+			definitions[name] = def;
+			for (const std::string& changed_name : changed)
+			{
+				symbols[changed_name] = changed_name == name && symbol ? *symbol : this->compile_definition(definitions[changed_name]);
+			}
+		}
+		catch (...)
+		{
+			definitions.erase(name);
+			symbols.erase(name);
+			for (const auto& old : old_definitions) definitions[old.first] = old.second;
+			for (const auto& old : old_symbols) symbols[old.first] = old.second;
+			throw;
+		}
+
+		return changed;
+	}
+
+public:
+	// Whether a name can be defined. It has to be a word that the tokenizer reads as one name, and not one of
+	// the functions, constants or variables that are already there.
+	static bool is_definable(const std::string& name)
+	{
+		static const char* reserved[] = { "x", "y", "t", "theta", "pi", "e", "cos", "sin", "tan", "sqrt", "ln", "log" };
+
+		if (name.empty() || name[0] == 'x') return false;
+		for (char c : name)
+		{
+			if (!isalpha(c)) return false;
+		}
+		for (const char* word : reserved)
+		{
+			if (name == word) return false;
+		}
+
+		return true;
+	}
+
+	// The names that an expression uses, out of those that are defined.
+	std::set<std::string> uses(const std::string& text) const
+	{
+		std::set<std::string> names;
+		Tokenizer tokenizer(text);
+
+		for (const Token& tok : tokenizer.tokenize())
+		{
+			if (tok.type == TokenKind::function && definitions.count(tok.value)) names.insert(tok.value);
+		}
+
+		return names;
+	}
+
+	// The name and every definition that depends on it, each after the ones it uses. These are the names whose
+	// meaning changes when `name` is defined again.
+	std::vector<std::string> dependents(const std::string& name) const
+	{
+		std::set<std::string> visited;
+		std::vector<std::string> order;
+		this->add_dependents(name, visited, order);
+		std::reverse(order.begin(), order.end());
+
+		return order;
+	}
+
+	// The definitions in the form `CompiledExpr` takes them.
+	const SymbolMap* symbol_map() const
+	{
+		return &symbols;
+	}
+
+	// Defines a number, or a function of x if param is given, or changes an existing definition.
+	// Returns the names whose meaning changed: the name itself and every definition that depends on it, each
+	// after the ones it uses. If the definition or one that depends on it can't be compiled anymore, nothing
+	// is changed and InvalidDefinition or the error of the compiler is thrown.
+	std::vector<std::string> define(const std::string& name, const std::string& param, const std::string& body)
+	{
+		// The parameter is read as x, so it has to be one of the variables the compiler reads as x
+		if (!is_definable(name) || !(param.empty() || param == "x" || param == "t" || param == "theta"))
+		{
+			throw InvalidDefinition();
+		}
+
+		Definition def = { param, body, this->uses(body) };
+		std::set<std::string> visited;
+		for (const std::string& used : def.uses)
+		{
+			if (used == name || this->depends_on(used, name, visited)) throw InvalidDefinition();
+		}
+
+		return this->replace(name, def, NULL);
+	}
+
+	// Gives a number a new value, or defines it with the value if it isn't defined. The value is used as it is,
+	// so it isn't rounded by being written out and parsed again, which makes this fast enough for every frame
+	// of a slider. Returns the names whose meaning changed, like `define`, and throws InvalidDefinition without
+	// changing anything if the name is a function, or a definition that depends on it can't have the value.
+	std::vector<std::string> set_number(const std::string& name, double value)
+	{
+		auto old = definitions.find(name);
+		if (!is_definable(name) || !isfinite(value) || (old != definitions.end() && !old->second.param.empty()))
+		{
+			throw InvalidDefinition();
+		}
+
+		// The body is the number written without an exponent, since e is read as the constant
+		std::ostringstream body;
+		body << std::fixed << std::setprecision(17) << value;
+		Definition def = { "", body.str(), std::set<std::string>() };
+
+		Symbol symbol;
+		symbol.is_function = false;
+		symbol.value = value;
+
+		return this->replace(name, def, &symbol);
+	}
+};
@@ -1,9 +1,17 @@
 #include "mainwindow.h"
+#include "ParserBenchmark.h"
 
 #include <QApplication>
+#include <cstring>
 
 int main(int argc, char *argv[])
 {
+    //Run the parser benchmark instead of the program when started with --benchmark-parser
+    if (argc > 1 && std::strcmp(argv[1], "--benchmark-parser") == 0)
+    {
+        return run_parser_benchmark(std::cout) ? 0 : 1;
+    }
+
     QApplication a(argc, argv);
     MainWindow w;
     w.show();
@@ -5,8 +5,26 @@
 #include "Matrix_NxN.h"
 #include "Parser.h"
 #include "InputHandler.h"
+#include "ImplicitCurve.h"
+#include "ParametricCurve.h"
+#include "ODESolver.h"
+#include "Derivative.h"
+#include "GraphSampler.h"
+#include "FunctionAnalyzer.h"
+#include "Integrator.h"
+#include "SymbolTable.h"
+#include "ExpressionDag.h"
 #include <QCoreApplication>
+#include <QElapsedTimer>
+#include <QFutureWatcher>
+#include <QMutex>
+#include <QSlider>
+#include <QTimer>
+#include <algorithm>
 #include <exception>
+#include <map>
+#include <memory>
+#include <set>
 
 //Create global variables
 double x_max = 50;
@@ -17,6 +35,385 @@ int ind_color_num = 0;
 QString historie;
 QColor qs[10] {};
 
+//All vectors of the same color are drawn by one vector field, indexed like the colors
+QPointer<QCPVectorField> vec_fields[10];
+
+//The last differential equation that was plotted, double clicking the plot draws its solution through that point
+//with the same method
+std::shared_ptr<CompiledExpr> last_ode;
+ODEMethod last_ode_method = dormand_prince;
+
+//The derivatives of every function that has been differentiated, by the text of the function, so it is only parsed once
+std::map<std::string, std::shared_ptr<DerivativeChain>> derivative_chains;
+
+//The numbers and functions the user has defined, like a = 2 and g(x) = a*sin(x)
+SymbolTable symbol_table;
+
+//An input that uses definitions, and everything it added to the plot, so it can be drawn again when one of them changes
+struct PlotRecord
+{
+    QString input;
+    int color;
+    QList<QPointer<QCPAbstractPlottable>> plottables;
+    QList<QPointer<QCPAbstractItem>> items;
+};
+
+//The inputs that use each definition
+std::map<std::string, std::vector<std::shared_ptr<PlotRecord>>> plots_using;
+
+//The x-values that F(...) is sampled at, and the expressions of the graphs drawn there as one DAG, so whatever
+//several graphs have in common is only evaluated once. A new grid is made when the range or spacing changes
+struct SharedGrid
+{
+    SharedGrid(double f, double t, double s) : from(f), to(t), spacing(s), dag(InputHandler::func_grid(f, t, s)) {}
+
+    double from;
+    double to;
+    double spacing;
+    ExpressionDag dag;
+    std::vector<std::pair<QPointer<QCPGraph>, int>> graphs; //The node of every graph on the grid
+};
+std::shared_ptr<SharedGrid> shared_grid;
+
+//Evaluate a function of x on the grid of F(...), with the nodes it shares with the graphs already drawn there
+//reused. The nodes that only removed graphs used are dropped first. Returns the node of the function
+static int eval_on_shared_grid(const CompiledExpr &expr, std::vector<double> &xs, std::vector<double> &ys)
+{
+    if(!shared_grid || shared_grid->from != x_min || shared_grid->to != x_max || shared_grid->spacing != func_spacing)
+    {
+        shared_grid = std::make_shared<SharedGrid>(x_min, x_max, func_spacing);
+    }
+
+    std::vector<std::pair<QPointer<QCPGraph>, int>> &graphs = shared_grid->graphs;
+    size_t old_count = graphs.size();
+    graphs.erase(std::remove_if(graphs.begin(), graphs.end(), [](const std::pair<QPointer<QCPGraph>, int> &graph) { return !graph.first; }), graphs.end());
+    if(graphs.size() < old_count)
+    {
+        std::vector<int> roots;
+        for(const auto &graph : graphs)
+        {
+            roots.push_back(graph.second);
+        }
+        roots = shared_grid->dag.compact(roots);
+        for(size_t i = 0; i < graphs.size(); i++)
+        {
+            graphs[i].second = roots[i];
+        }
+    }
+
+    int root = shared_grid->dag.add(expr);
+    xs = shared_grid->dag.grid();
+    ys = shared_grid->dag.values_of(root);
+    return root;
+}
+
+//The values of a function of x that the graphs of F(...) have already been evaluated to, at the x-values of
+//the grid in [from, to]. Returns false if it isn't one of them or a part of one
+static bool plotted_samples(const CompiledExpr &expr, double from, double to, std::vector<double> &xs, std::vector<double> &ys)
+{
+    int node = shared_grid ? shared_grid->dag.find(expr) : -1;
+    if(node < 0)
+    {
+        return false;
+    }
+
+    const std::vector<double> &grid = shared_grid->dag.grid();
+    const std::vector<double> &values = shared_grid->dag.values_of(node);
+    xs.clear();
+    ys.clear();
+    for(size_t i = 0; i < grid.size(); i++)
+    {
+        if(grid[i] >= from && grid[i] <= to)
+        {
+            xs.push_back(grid[i]);
+            ys.push_back(values[i]);
+        }
+    }
+    return xs.size() >= 2;
+}
+
+//A graph of F(...) that is evaluated again every frame while a slider it uses is dragged. The numbers of the
+//slider are bound in its compiled expression, so it doesn't have to be compiled again. It is evaluated on its
+//own rather than in the DAG of the grid, where every value of the number would make new nodes for all that use it
+struct LiveGraph
+{
+    LiveGraph(const CompiledExpr &e) : expr(e) {}
+
+    QPointer<QCPGraph> graph;
+    CompiledExpr expr;
+    QVector<double> xs;
+};
+
+//A slider that sets a defined number. While it is dragged, the frame timer applies only the newest value once
+//per frame and skips the ones in between. Every `stride`'th point of the graphs is drawn, and the stride grows
+//when a frame takes longer than its budget. Everything that uses the number is drawn properly on release
+struct SliderState
+{
+    std::string name;
+    double from;
+    double to;
+    QPointer<QSlider> slider;
+    QPointer<QLabel> label;
+    QPointer<QTimer> frame_timer;
+    double value = 0;
+    bool pending = false;
+    bool moved = false;
+    int stride = 1;
+    std::vector<std::shared_ptr<LiveGraph>> live;
+};
+
+//The sliders, by the name of their number
+std::map<std::string, std::shared_ptr<SliderState>> sliders;
+
+//The positions of a slider, and the time one frame may take while it is dragged
+const int slider_steps = 1000;
+const int frame_ms = 16;
+const int max_stride = 64;
+
+//Evaluate a function of x at many points, split into chunks that are evaluated in parallel
+static void eval_parallel(const CompiledExpr &expr, const QVector<double> &xs, QVector<double> &ys)
+{
+    const int chunk = 4096;
+    ys.resize(xs.size());
+    const double *in = xs.constData();
+    double *out = ys.data();
+
+    QVector<int> starts;
+    for(int start = 0; start < xs.size(); start += chunk)
+    {
+        starts.append(start);
+    }
+    int size = xs.size();
+    QtConcurrent::blockingMap(starts, [&expr, in, out, size, chunk](const int &start)
+    {
+        expr.eval_batch(in + start, in + start, out + start, qMin(chunk, size - start));
+    });
+}
+
+//Copy samples into the QVector the plottables take
+static QVector<double> to_qvector(const std::vector<double> &values)
+{
+    QVector<double> out(int(values.size()));
+    std::copy(values.begin(), values.end(), out.begin());
+    return out;
+}
+
+//A color map data that is being filled with the values of an expression in x and y
+struct FieldJob
+{
+    FieldJob(const CompiledExpr &e) : expr(e) {}
+
+    CompiledExpr expr;
+    QCPColorMapData *data;
+    std::unique_ptr<QCPColorMapData> owned; //The data if the job made it, until it is handed to a color map
+    double *cells;
+    QVector<double> xs;
+    QVector<double> ys;
+    QList<QCPDataRange> tiles;
+};
+
+//Prepare the coordinates of the cells and split the rows into tiles that can be evaluated in parallel
+static std::shared_ptr<FieldJob> make_field_job(const CompiledExpr &expr, QCPColorMapData *data)
+{
+    auto job = std::make_shared<FieldJob>(expr);
+    job->data = data;
+    job->cells = data->scanLine(0);
+
+    //The x-value of every column and the y-value of every row
+    double unused;
+    job->xs.resize(data->keySize());
+    for(int k = 0; k < data->keySize(); k++)
+    {
+        data->cellToCoord(k, 0, &job->xs[k], &unused);
+    }
+    job->ys.resize(data->valueSize());
+    for(int v = 0; v < data->valueSize(); v++)
+    {
+        data->cellToCoord(0, v, &unused, &job->ys[v]);
+    }
+
+    //Every tile gets at least 16k cells, and there are a few more tiles than threads so they even out
+    int rows = data->valueSize();
+    int tile_count = qBound(1, rows*data->keySize()/16384, QThreadPool::globalInstance()->maxThreadCount()*4);
+    int rows_per_tile = (rows + tile_count - 1)/tile_count;
+    for(int row = 0; row < rows; row += rows_per_tile)
+    {
+        job->tiles.append(QCPDataRange(row, qMin(row + rows_per_tile, rows)));
+    }
+
+    return job;
+}
+
+//Evaluate the expression for all cells in the rows of a tile, one whole row at a time
+static void fill_field_tile(const FieldJob &job, const QCPDataRange &rows)
+{
+    int row_size = job.xs.size();
+    QVector<double> row_ys(row_size);
+    for(int row = rows.begin(); row < rows.end(); row++)
+    {
+        row_ys.fill(job.ys[row]);
+        job.expr.eval_batch(job.xs.constData(), row_ys.constData(), job.cells + row*row_size, row_size);
+    }
+}
+
+//The points of a slope field and the segment drawn at every point, from its start (xs, ys) in the direction (dxs, dys)
+struct SlopeLattice
+{
+    QVector<double> xs;
+    QVector<double> ys;
+    QVector<double> dxs;
+    QVector<double> dys;
+};
+
+//Evaluate the slopes on a lattice with a point every `spacing` pixels of the visible area. The lattice is aligned to multiples of its step, so the points stay in place while the plot is dragged
+static SlopeLattice compute_slope_lattice(const CompiledExpr &expr, QCPRange x_range, QCPRange y_range, double width, double height, double spacing)
+{
+    SlopeLattice lattice;
+    double x_scale = width/x_range.size();
+    double y_scale = height/y_range.size();
+    double step_x = spacing/x_scale;
+    double step_y = spacing/y_scale;
+    int i_begin = qCeil(x_range.lower/step_x);
+    int j_begin = qCeil(y_range.lower/step_y);
+    int nx = qMax(0, qFloor(x_range.upper/step_x) - i_begin + 1);
+    int ny = qMax(0, qFloor(y_range.upper/step_y) - j_begin + 1);
+    int n = nx*ny;
+
+    lattice.xs.resize(n);
+    lattice.ys.resize(n);
+    for(int j = 0; j < ny; j++)
+    {
+        for(int i = 0; i < nx; i++)
+        {
+            lattice.xs[j*nx + i] = (i_begin + i)*step_x;
+            lattice.ys[j*nx + i] = (j_begin + j)*step_y;
+        }
+    }
+
+    //All slopes are evaluated in one batch
+    QVector<double> slopes(n);
+    expr.eval_batch(lattice.xs.constData(), lattice.ys.constData(), slopes.data(), n);
+
+    //Every segment has the same length on screen and is centered on its point. Where the slope is undefined the direction is NaN, so no segment is drawn
+    double segment = spacing*0.7;
+    lattice.dxs.resize(n);
+    lattice.dys.resize(n);
+    for(int k = 0; k < n; k++)
+    {
+        double slope = slopes[k];
+        if(qIsInf(slope))
+        {
+            lattice.dxs[k] = 0;
+            lattice.dys[k] = segment/y_scale;
+        } else
+        {
+            double length = qSqrt(x_scale*x_scale + slope*y_scale*slope*y_scale);
+            lattice.dxs[k] = segment/length;
+            lattice.dys[k] = slope*segment/length;
+        }
+        lattice.xs[k] -= lattice.dxs[k]/2;
+        lattice.ys[k] -= lattice.dys[k]/2;
+    }
+
+    return lattice;
+}
+
+//A slope field that follows the viewport. It is deleted together with its vector field
+struct SlopeFieldState
+{
+    SlopeFieldState(const CompiledExpr &e) : expr(e), outdated(false) {}
+
+    CompiledExpr expr;
+    QPointer<QCPVectorField> field;
+    QTimer timer;
+    QFutureWatcher<SlopeLattice> watcher;
+    bool outdated;
+};
+
+//Compute the lattice for the current viewport in the background. Only one lattice is computed at a time, if the viewport changes in the meantime it is computed again afterwards
+static void start_slope_lattice(SlopeFieldState *state, QCustomPlot *plot)
+{
+    if(state->watcher.isRunning())
+    {
+        state->outdated = true;
+        return;
+    }
+    state->outdated = false;
+
+    CompiledExpr expr = state->expr;
+    QCPRange x_range = plot->xAxis->range();
+    QCPRange y_range = plot->yAxis->range();
+    double width = qMax(1, plot->axisRect()->width());
+    double height = qMax(1, plot->axisRect()->height());
+    state->watcher.setFuture(QtConcurrent::run([expr, x_range, y_range, width, height]()
+    {
+        return compute_slope_lattice(expr, x_range, y_range, width, height, 24);
+    }));
+}
+
+//Solutions of a differential equation that are computed in the background, one curve per initial condition.
+//The points are collected in `pending` until the GUI thread moves them to the curves
+struct ODEJob
+{
+    ODEJob(const CompiledExpr &e) : expr(e) {}
+
+    CompiledExpr expr;
+    ODEMethod method;
+    std::vector<double> x0s;
+    std::vector<double> y0s;
+    QVector<int> seeds;
+    QVector<QPointer<QCPCurve>> curves;
+    QCPRange x_range;
+    QCPRange y_range;
+    double x_scale;
+    double y_scale;
+
+    QMutex mutex;
+    QVector<QVector<QCPCurveData>> pending;
+};
+
+//Solve from one initial condition to both sides of the visible area, and hand over the points in blocks as they are produced
+static void solve_ode_seed(ODEJob &job, int seed)
+{
+    //Steps are accurate to a quarter of a pixel, and points are output about 2 pixels apart
+    ODESolver solver(job.expr, job.x_scale, job.y_scale, 0.25, 2.0, job.y_range.lower, job.y_range.upper);
+    QVector<QCPCurveData> block;
+
+    auto flush = [&job, &block, seed]()
+    {
+        QMutexLocker locker(&job.mutex);
+        job.pending[seed] += block;
+        block.clear();
+    };
+
+    //The points are keyed by x, so the points from both directions end up in the right order on the curve
+    auto out = [&block, &flush](double x, double y)
+    {
+        block.append(QCPCurveData(x, x, y));
+        if(block.size() == 1024)
+        {
+            flush();
+        }
+    };
+
+    double x0 = job.x0s[seed];
+    double y0 = job.y0s[seed];
+    out(x0, y0);
+    solver.solve(job.method, x0, y0, job.x_range.upper, out);
+    solver.solve(job.method, x0, y0, job.x_range.lower, out);
+    flush();
+}
+
+//An integral that is computed in the background. The interval is split into pieces that are integrated in parallel
+struct IntegralJob
+{
+    IntegralJob(const CompiledExpr &e) : expr(e) {}
+
+    CompiledExpr expr;
+    QVector<int> pieces;
+    std::vector<double> ends;
+    std::vector<Quadrature> results;
+};
 
 MainWindow::MainWindow(QWidget *parent)
     : QMainWindow(parent)
@@ -55,6 +452,7 @@ MainWindow::MainWindow(QWidget *parent)
     connect(MainWindow::findChild<QPushButton *>("buttonMin"), SIGNAL(released()),this, SLOT(min_x()));
     connect(MainWindow::findChild<QPushButton *>("buttonReset"), SIGNAL(released()),this, SLOT(plot_reset()));
     connect(MainWindow::findChild<QPushButton *>("buttonSpacing"), SIGNAL(released()),this, SLOT(change_spacing()));
+    connect(ui->customPlot, SIGNAL(mouseDoubleClick(QMouseEvent*)), this, SLOT(plot_double_clicked(QMouseEvent*)));
 
     //Change the font of the history and make it bold
     QFont font = ui->historie->font();
@@ -64,33 +462,31 @@ MainWindow::MainWindow(QWidget *parent)
 
     //Create an interaction where you can select, zoom, and drag the plot
     ui->customPlot->setInteractions(QCP::iRangeDrag | QCP::iRangeZoom | QCP::iSelectPlottables);
+
+    //Only redraw the layers that changed when replotting, and give the plots their own buffer so a new plot is just drawn on top of the old ones
+    ui->customPlot->setPlottingHint(QCP::phIncrementalReplot);
+    ui->customPlot->layer("main")->setMode(QCPLayer::lmBuffered);
 }
 void MainWindow::draw_vec(Vector_N<2> vec)
 {
-    //Create vector and set start and end value of the vector
-    QVector<double> x(2), y(2);
+    //The vector goes from the origin to its coordinates
     double x2 = vec.get_x();
     double y2 = vec.get_y();
-    x[0] = 0;
-    x[1] = x2;
-    y[0] = 0;
-    y[1] = y2;
 
-    //Create a new graph and set the data
-    ui->customPlot->addGraph();
-    ui->customPlot->graph(ind_plot)->setData(x, y);
+    //Create the vector field for the current color if there isn't one yet (or it was removed by a reset)
+    if(!vec_fields[ind_color_num])
+    {
+        vec_fields[ind_color_num] = new QCPVectorField(ui->customPlot->xAxis, ui->customPlot->yAxis);
 
-    //Create a pen that sets the color and width of the vector line
-    QPen vecPen;
-    vecPen.setColor(qs[ind_color_num]);
-    vecPen.setWidth(2);
-    ui->customPlot->graph(ind_plot)->setPen(vecPen);
+        //Create a pen that sets the color and width of the vector lines, the arrowheads get the same color
+        QPen vecPen;
+        vecPen.setColor(qs[ind_color_num]);
+        vecPen.setWidth(2);
+        vec_fields[ind_color_num]->setPen(vecPen);
+    }
 
-    //Create an arrowhead at the end of the vector and make it the same color and width as the line
-    QCPItemLine *arrow = new QCPItemLine(ui->customPlot);
-    arrow->end->setCoords(x[1], y[1]);
-    arrow->setHead(QCPLineEnding::esSpikeArrow);
-    arrow->setPen(vecPen);
+    //Add the vector to the field of its color
+    vec_fields[ind_color_num]->addData(0, 0, x2, y2);
 
     //Scale the axes so all the plots can be seen and then refresh the plot
     ui->customPlot->rescaleAxes();
@@ -115,8 +511,7 @@ void MainWindow::draw_vec(Vector_N<2> vec)
                          "</tr>"
                        "</table>");
 
-    //The variable that contains the number of plots and the index of what color is being used goes up
-    ind_plot++;
+    //The index of what color is being used goes up
     ind_color_num++;
 
     //If the color index goes out of bounds reset it
@@ -126,7 +521,7 @@ void MainWindow::draw_vec(Vector_N<2> vec)
     }
 }
 
-void MainWindow::draw_func(std::vector<Vector_N<2>> expr)
+QCPGraph *MainWindow::draw_func(std::vector<Vector_N<2>> expr)
 {
         //Set the amount of points in the graph
         int num_points = expr.size();
@@ -140,14 +535,14 @@ void MainWindow::draw_func(std::vector<Vector_N<2>> expr)
         }
 
         //Create a new graph and set the data
-        ui->customPlot->addGraph();
-        ui->customPlot->graph(ind_plot)->setData(x1,y1);
+        QCPGraph *graph = ui->customPlot->addGraph();
+        graph->setData(x1,y1);
 
         //Set the color of the graph
         QPen linePen;
         linePen.setColor(qs[ind_color_num]);
         linePen.setWidth(2);
-        ui->customPlot->graph(ind_plot)->setPen(linePen);
+        graph->setPen(linePen);
 
         //Rescale the axes so you can see all the plots and then refresh the plots
         ui->customPlot->rescaleAxes();
@@ -165,7 +560,564 @@ void MainWindow::draw_func(std::vector<Vector_N<2>> expr)
         {
             ind_color_num = 0;
         }
+
+        return graph;
+    }
+
+void MainWindow::draw_field(const CompiledExpr &expr)
+{
+    //The field covers what is visible right now, with one cell per pixel of the plot
+    QCPRange x_range = ui->customPlot->xAxis->range();
+    QCPRange y_range = ui->customPlot->yAxis->range();
+    int width = qMax(2, ui->customPlot->axisRect()->width());
+    int height = qMax(2, ui->customPlot->axisRect()->height());
+
+    //Create a new color map in the same axes as the other plots
+    QCPColorMap *color_map = new QCPColorMap(ui->customPlot->xAxis, ui->customPlot->yAxis);
+    color_map->setGradient(QCPColorGradient::gpThermal);
+
+    //The map is hidden until the first grid has been evaluated
+    color_map->setVisible(false);
+    ui->customPlot->replot();
+
+    //Set the history label to the expression
+    ui->historie->setText(historie);
+
+    //Evaluate a coarse grid with one cell per 8x8 pixels and then the full resolution, both in the background.
+    //Each is swapped in when it is done, and the jobs free their data if the map doesn't take it
+    std::shared_ptr<FieldJob> coarse = make_field_job(expr, new QCPColorMapData(qMax(2, width/8), qMax(2, height/8), x_range, y_range));
+    coarse->owned.reset(coarse->data);
+    std::shared_ptr<FieldJob> full = make_field_job(expr, new QCPColorMapData(width, height, x_range, y_range));
+    full->owned.reset(full->data);
+    QPointer<QCPColorMap> map_ptr(color_map);
+    QFutureWatcher<void> *watcher = new QFutureWatcher<void>(this);
+    connect(watcher, &QFutureWatcher<void>::finished, this, [this, coarse, full, map_ptr, watcher]()
+    {
+        //The color map may have been removed by a reset in the meantime
+        if(!map_ptr)
+        {
+            watcher->deleteLater();
+            return;
+        }
+
+        //The coarse grid is shown while the full resolution is evaluated with the same watcher
+        bool coarse_done = coarse->owned != nullptr;
+        map_ptr->setData(coarse_done ? coarse->owned.release() : full->owned.release());
+        map_ptr->rescaleDataRange(true);
+        map_ptr->setVisible(true);
+        ui->customPlot->replot();
+
+        if(coarse_done)
+        {
+            watcher->setFuture(QtConcurrent::map(full->tiles, [full](const QCPDataRange &rows) { fill_field_tile(*full, rows); }));
+        } else
+        {
+            watcher->deleteLater();
+        }
+    });
+    watcher->setFuture(QtConcurrent::map(coarse->tiles, [coarse](const QCPDataRange &rows) { fill_field_tile(*coarse, rows); }));
+}
+
+void MainWindow::draw_implicit(const CompiledExpr &expr)
+{
+    //Trace the curve in what is visible right now, with coarse cells of 8x8 pixels that are refined 3 times down to single pixels
+    QCPRange x_range = ui->customPlot->xAxis->range();
+    QCPRange y_range = ui->customPlot->yAxis->range();
+    int nx = qMax(2, ui->customPlot->axisRect()->width()/8);
+    int ny = qMax(2, ui->customPlot->axisRect()->height()/8);
+    ImplicitCurve curve(expr, x_range.lower, x_range.upper, y_range.lower, y_range.upper, nx, ny, 3);
+
+    //Split the rows of coarse cells into tiles and trace them in parallel
+    int tile_count = qMin(ny, QThreadPool::globalInstance()->maxThreadCount()*4);
+    std::vector<ImplicitTile> tiles(tile_count);
+    for(int t = 0; t < tile_count; t++)
+    {
+        tiles[t].row_begin = t*ny/tile_count;
+        tiles[t].row_end = (t + 1)*ny/tile_count;
+    }
+    QtConcurrent::blockingMap(tiles, [&curve](ImplicitTile &tile) { curve.trace(tile); });
+
+    //Join the segments of all tiles into polylines, separated by NaN so the curve has gaps between them
+    std::vector<double> xs, ys;
+    curve.stitch(tiles, xs, ys);
+
+    //Create a new curve and set the data
+    int num_points = xs.size();
+    QVector<double> x1(num_points), y1(num_points);
+    for(int i = 0; i < num_points; i++)
+    {
+        x1[i] = xs[i];
+        y1[i] = ys[i];
+    }
+    QCPCurve *implicit = new QCPCurve(ui->customPlot->xAxis, ui->customPlot->yAxis);
+    implicit->setData(x1, y1);
+
+    //Set the color of the curve
+    QPen linePen;
+    linePen.setColor(qs[ind_color_num]);
+    linePen.setWidth(2);
+    implicit->setPen(linePen);
+
+    //Refresh the plot and set the history label to the equation
+    ui->customPlot->replot();
+    ui->historie->setText(historie);
+
+    //The index of the color being used goes up, and is reset if it goes out of bounds
+    ind_color_num++;
+    if(ind_color_num == 10)
+    {
+        ind_color_num = 0;
+    }
+}
+
+void MainWindow::draw_contour(const CompiledExpr &expr)
+{
+    //Evaluate the expression once on a grid over what is visible right now, with one cell per 2x2 pixels
+    QCPRange x_range = ui->customPlot->xAxis->range();
+    QCPRange y_range = ui->customPlot->yAxis->range();
+    int width = qMax(2, ui->customPlot->axisRect()->width()/2);
+    int height = qMax(2, ui->customPlot->axisRect()->height()/2);
+
+    QCPContour *contour = new QCPContour(ui->customPlot->xAxis, ui->customPlot->yAxis);
+    contour->data()->setSize(width, height);
+    contour->data()->setRange(x_range, y_range);
+    std::shared_ptr<FieldJob> job = make_field_job(expr, contour->data());
+    QtConcurrent::blockingMap(job->tiles, [job](const QCPDataRange &rows) { fill_field_tile(*job, rows); });
+
+    //All 20 levels are extracted from the same grid
+    contour->rescaleLevels(20, true);
+
+    //Set the color of the contour lines
+    QPen linePen;
+    linePen.setColor(qs[ind_color_num]);
+    contour->setPen(linePen);
+
+    //Refresh the plot and set the history label to the expression
+    ui->customPlot->replot();
+    ui->historie->setText(historie);
+
+    //The index of the color being used goes up, and is reset if it goes out of bounds
+    ind_color_num++;
+    if(ind_color_num == 10)
+    {
+        ind_color_num = 0;
+    }
+}
+
+void MainWindow::draw_parametric(const CompiledExpr &fx, const CompiledExpr &fy, double t_min, double t_max)
+{
+    //Place the samples about one pixel apart at the current zoom, but never more than 10 million of them
+    double x_scale = ui->customPlot->axisRect()->width()/ui->customPlot->xAxis->range().size();
+    double y_scale = ui->customPlot->axisRect()->height()/ui->customPlot->yAxis->range().size();
+    ParametricCurve curve(fx, fy, t_min, t_max, x_scale, y_scale, 1.0, 10000000);
+    draw_sampled_curve(curve);
+}
+
+void MainWindow::draw_polar(const CompiledExpr &fr, double theta_min, double theta_max)
+{
+    //Place the samples about one pixel apart at the current zoom, but never more than 10 million of them
+    double x_scale = ui->customPlot->axisRect()->width()/ui->customPlot->xAxis->range().size();
+    double y_scale = ui->customPlot->axisRect()->height()/ui->customPlot->yAxis->range().size();
+    PolarCurve curve(fr, theta_min, theta_max, x_scale, y_scale, 1.0, 10000000);
+    draw_sampled_curve(curve);
+}
+
+void MainWindow::draw_sampled_curve(const CurveSampler &curve)
+{
+    //Sample the chunks in parallel, straight into the data points of the curve. The samples come out sorted by t
+    QVector<QCPCurveData> points(curve.size());
+    QCPCurveData *out = points.data();
+    std::vector<ParametricChunk> chunks = curve.chunks(QThreadPool::globalInstance()->maxThreadCount()*4);
+    QtConcurrent::blockingMap(chunks, [&curve, out](const ParametricChunk &chunk)
+    {
+        curve.sample(chunk, [out](size_t i, double t, double x, double y) { out[i] = QCPCurveData(t, x, y); });
+    });
+
+    //Create a new curve and hand it the data without sorting it again
+    QSharedPointer<QCPCurveDataContainer> data(new QCPCurveDataContainer);
+    data->set(points, true);
+    QCPCurve *sampled = new QCPCurve(ui->customPlot->xAxis, ui->customPlot->yAxis);
+    sampled->setData(data);
+
+    //Set the color of the curve
+    QPen linePen;
+    linePen.setColor(qs[ind_color_num]);
+    linePen.setWidth(2);
+    sampled->setPen(linePen);
+
+    //Refresh the plot and set the history label to the curve
+    ui->customPlot->replot();
+    ui->historie->setText(historie);
+
+    //The index of the color being used goes up, and is reset if it goes out of bounds
+    ind_color_num++;
+    if(ind_color_num == 10)
+    {
+        ind_color_num = 0;
+    }
+}
+
+void MainWindow::draw_graph(const CompiledExpr &expr)
+{
+    QCustomPlot *plot = ui->customPlot;
+    QCPGraph *graph = plot->addGraph();
+    std::shared_ptr<CompiledExpr> shared_expr = std::make_shared<CompiledExpr>(expr);
+
+    //Sample the function at every pixel of the visible part of the x-axis. The sampler skips the parts above and
+    //below the plot and breaks the graph at asymptotes
+    auto resample = [graph, plot, shared_expr]()
+    {
+        QCPRange x_range = plot->xAxis->range();
+        QCPRange y_range = plot->yAxis->range();
+        GraphSampler sampler(*shared_expr, x_range.lower, x_range.upper, qMax(1, plot->axisRect()->width()), y_range.lower, y_range.upper);
+        std::vector<double> xs, ys;
+        sampler.sample(xs, ys);
+        graph->setData(to_qvector(xs), to_qvector(ys), true);
+    };
+    resample();
+
+    //Sample it again when the axes are moved or zoomed, for as long as the graph exists
+    auto on_range_changed = [resample, plot]()
+    {
+        resample();
+        plot->replot(QCustomPlot::rpQueuedReplot);
+    };
+    connect(plot->xAxis, static_cast<void (QCPAxis::*)(const QCPRange &)>(&QCPAxis::rangeChanged), graph, on_range_changed);
+    connect(plot->yAxis, static_cast<void (QCPAxis::*)(const QCPRange &)>(&QCPAxis::rangeChanged), graph, on_range_changed);
+
+    //Set the color of the graph
+    QPen linePen;
+    linePen.setColor(qs[ind_color_num]);
+    linePen.setWidth(2);
+    graph->setPen(linePen);
+
+    //Refresh the plot and set the history label to the function
+    plot->replot();
+    ui->historie->setText(historie);
+
+    //The variable with the amount of plots and index of the color being used goes up
+    ind_plot++;
+    ind_color_num++;
+
+    //If the color index goes out of bounds reset it
+    if(ind_color_num == 10)
+    {
+        ind_color_num = 0;
+    }
+}
+
+void MainWindow::draw_features(const std::vector<CompiledExpr> &funcs, bool extrema)
+{
+    //Bracket the features in the visible part of the x-axis. If the functions are drawn with F(...) the samples
+    //they were drawn with are used, otherwise the visible part is sampled
+    QCustomPlot *plot = ui->customPlot;
+    QCPRange range = plot->xAxis->range();
+    std::shared_ptr<FunctionAnalyzer> analyzer(funcs.size() == 2 ? new FunctionAnalyzer(funcs[0], funcs[1]) : new FunctionAnalyzer(funcs[0]));
+    std::vector<double> xs, ys, g_xs, g_ys;
+    std::vector<Bracket> all_brackets;
+    if(funcs.size() == 2 && plotted_samples(funcs[0], range.lower, range.upper, xs, ys) && plotted_samples(funcs[1], range.lower, range.upper, g_xs, g_ys))
+    {
+        for(size_t i = 0; i < ys.size(); i++)
+        {
+            ys[i] -= g_ys[i];
+        }
+        all_brackets = analyzer->brackets(xs, ys);
+    }
+    else if(funcs.size() == 1 && plotted_samples(funcs[0], range.lower, range.upper, xs, ys))
+    {
+        all_brackets = analyzer->brackets(xs, ys);
+    }
+    else
+    {
+        all_brackets = analyzer->brackets(range.lower, range.upper);
+    }
+
+    QVector<Bracket> brackets;
+    for(const Bracket &bracket : all_brackets)
+    {
+        bool is_extremum = bracket.kind == feature_minimum || bracket.kind == feature_maximum;
+        if(is_extremum == extrema)
+        {
+            brackets.append(bracket);
+        }
+    }
+
+    //The features are marked with circles, or squares for the minima and maxima, by a graph without lines. It is
+    //there from the start, so it belongs to the input like the other graphs and is removed with them
+    QCPGraph *marks = plot->addGraph();
+    marks->setLineStyle(QCPGraph::lsNone);
+    marks->setScatterStyle(QCPScatterStyle(extrema ? QCPScatterStyle::ssSquare : QCPScatterStyle::ssCircle, QPen(qs[ind_color_num], 2), Qt::NoBrush, 8));
+
+    //Refine all brackets in parallel, and mark the features that were found when they are done
+    QPointer<QCPGraph> marks_ptr(marks);
+    QFutureWatcher<Feature> *watcher = new QFutureWatcher<Feature>(this);
+    connect(watcher, &QFutureWatcher<Feature>::finished, this, [this, marks_ptr, watcher]()
+    {
+        //The graph may have been removed by a reset in the meantime
+        if(marks_ptr)
+        {
+            QVector<double> keys, values;
+            for(const Feature &feature : watcher->future().results())
+            {
+                if(feature.found)
+                {
+                    keys.append(feature.x);
+                    values.append(feature.y);
+                }
+            }
+            marks_ptr->setData(keys, values);
+            ui->customPlot->replot();
+        }
+        watcher->deleteLater();
+    });
+    watcher->setFuture(QtConcurrent::mapped(brackets, [analyzer](const Bracket &bracket) { return analyzer->refine(bracket); }));
+
+    //Refresh the plot and set the history label to the functions
+    plot->replot();
+    ui->historie->setText(historie);
+
+    //The variable with the amount of plots and index of the color being used goes up
+    ind_plot++;
+    ind_color_num++;
+
+    //If the color index goes out of bounds reset it
+    if(ind_color_num == 10)
+    {
+        ind_color_num = 0;
+    }
+}
+
+void MainWindow::draw_integral(const CompiledExpr &expr, double from, double to)
+{
+    //The area is filled between the graph of the function and a graph along the x-axis
+    QCustomPlot *plot = ui->customPlot;
+    QCPGraph *area = plot->addGraph();
+    QCPGraph *baseline = plot->addGraph();
+    area->setChannelFillGraph(baseline);
+    baseline->setPen(Qt::NoPen);
+    std::shared_ptr<CompiledExpr> shared_expr = std::make_shared<CompiledExpr>(expr);
+    double lower = qMin(from, to);
+    double upper = qMax(from, to);
+
+    //Only the visible part of the area is sampled, at every pixel, so the fill polygon never gets more points than the plot is wide
+    auto resample = [area, baseline, plot, shared_expr, lower, upper]()
+    {
+        QCPRange x_range = plot->xAxis->range();
+        QCPRange y_range = plot->yAxis->range();
+        double a = qMax(lower, x_range.lower);
+        double b = qMin(upper, x_range.upper);
+        if(a >= b)
+        {
+            area->data()->clear();
+            baseline->data()->clear();
+            return;
+        }
+
+        int pixels = qMax(1, qRound(plot->axisRect()->width()*(b - a)/x_range.size()));
+        GraphSampler sampler(*shared_expr, a, b, pixels, y_range.lower, y_range.upper);
+        std::vector<double> xs, ys;
+        sampler.sample(xs, ys);
+        area->setData(to_qvector(xs), to_qvector(ys), true);
+        baseline->setData(QVector<double>() << a << b, QVector<double>() << 0 << 0, true);
+    };
+    resample();
+
+    //Sample it again when the axes are moved or zoomed, for as long as the area exists
+    auto on_range_changed = [resample, plot]()
+    {
+        resample();
+        plot->replot(QCustomPlot::rpQueuedReplot);
+    };
+    connect(plot->xAxis, static_cast<void (QCPAxis::*)(const QCPRange &)>(&QCPAxis::rangeChanged), area, on_range_changed);
+    connect(plot->yAxis, static_cast<void (QCPAxis::*)(const QCPRange &)>(&QCPAxis::rangeChanged), area, on_range_changed);
+
+    //Set the color of the graph and a transparent version of it for the area
+    QColor fillColor = qs[ind_color_num];
+    fillColor.setAlpha(80);
+    QPen linePen;
+    linePen.setColor(qs[ind_color_num]);
+    linePen.setWidth(2);
+    area->setPen(linePen);
+    area->setBrush(fillColor);
+
+    //Integrate the pieces in parallel, and show the integral and its error next to the expression when they are done
+    std::shared_ptr<IntegralJob> job(new IntegralJob(expr));
+    int num_pieces = QThreadPool::globalInstance()->maxThreadCount()*4;
+    job->ends = Integrator::split(from, to, num_pieces);
+    job->results.resize(num_pieces);
+    for(int piece = 0; piece < num_pieces; piece++)
+    {
+        job->pieces.append(piece);
+    }
+
+    QString label = historie;
+    QFutureWatcher<void> *watcher = new QFutureWatcher<void>(this);
+    connect(watcher, &QFutureWatcher<void>::finished, this, [this, job, watcher, label]()
+    {
+        double value = 0;
+        double error = 0;
+        for(const Quadrature &result : job->results)
+        {
+            value += result.value;
+            error += result.error;
+        }
+
+        //Unless something else has been plotted in the meantime
+        if(ui->historie->text() == label)
+        {
+            ui->historie->setText(label + " = " + QString::number(value, 'g', 12) + " " + QChar(0x00B1) + " " + QString::number(error, 'g', 2));
+        }
+        watcher->deleteLater();
+    });
+    watcher->setFuture(QtConcurrent::map(job->pieces, [job](const int &piece)
+    {
+        job->results[piece] = Integrator(job->expr).integrate(job->ends[piece], job->ends[piece + 1]);
+    }));
+
+    //Refresh the plot and set the history label to the expression
+    plot->replot();
+    ui->historie->setText(historie);
+
+    //The variable with the amount of plots and index of the color being used goes up
+    ind_plot += 2;
+    ind_color_num++;
+
+    //If the color index goes out of bounds reset it
+    if(ind_color_num == 10)
+    {
+        ind_color_num = 0;
+    }
+}
+
+void MainWindow::draw_slope_field(const CompiledExpr &expr)
+{
+    //The segments are drawn by a vector field without arrowheads
+    QCPVectorField *field = new QCPVectorField(ui->customPlot->xAxis, ui->customPlot->yAxis);
+    field->setHeadSize(0);
+    field->setDecimationSize(0);
+    QPen linePen;
+    linePen.setColor(qs[ind_color_num]);
+    linePen.setWidth(1);
+    field->setPen(linePen);
+
+    SlopeFieldState *state = new SlopeFieldState(expr);
+    state->field = field;
+    connect(field, &QObject::destroyed, [state]() { delete state; });
+
+    //When the axes change, wait until they have been still for 50 ms before computing a new lattice
+    QCustomPlot *plot = ui->customPlot;
+    state->timer.setSingleShot(true);
+    state->timer.setInterval(50);
+    connect(plot->xAxis, static_cast<void (QCPAxis::*)(const QCPRange &)>(&QCPAxis::rangeChanged), &state->timer, [state]() { state->timer.start(); });
+    connect(plot->yAxis, static_cast<void (QCPAxis::*)(const QCPRange &)>(&QCPAxis::rangeChanged), &state->timer, [state]() { state->timer.start(); });
+    connect(&state->timer, &QTimer::timeout, [state, plot]() { start_slope_lattice(state, plot); });
+
+    //Show a finished lattice, unless the slope field was removed in the meantime
+    connect(&state->watcher, &QFutureWatcher<SlopeLattice>::finished, [state, plot]()
+    {
+        SlopeLattice lattice = state->watcher.result();
+        if(state->field)
+        {
+            state->field->setData(lattice.xs, lattice.ys, lattice.dxs, lattice.dys);
+            plot->replot(QCustomPlot::rpQueuedReplot);
+        }
+        if(state->outdated)
+        {
+            start_slope_lattice(state, plot);
+        }
+    });
+    start_slope_lattice(state, plot);
+
+    //Set the history label to the equation
+    ui->historie->setText(historie);
+
+    //The index of the color being used goes up, and is reset if it goes out of bounds
+    ind_color_num++;
+    if(ind_color_num == 10)
+    {
+        ind_color_num = 0;
+    }
+}
+
+void MainWindow::draw_ode_solutions(const CompiledExpr &expr, ODEMethod method, std::vector<double> x0s, std::vector<double> y0s)
+{
+    QCustomPlot *plot = ui->customPlot;
+    std::shared_ptr<ODEJob> job(new ODEJob(expr));
+    job->method = method;
+    job->x_range = plot->xAxis->range();
+    job->y_range = plot->yAxis->range();
+    job->x_scale = qMax(1, plot->axisRect()->width())/job->x_range.size();
+    job->y_scale = qMax(1, plot->axisRect()->height())/job->y_range.size();
+
+    //Without an initial condition the solutions start from a column of points in the middle of the plot
+    if(x0s.empty())
+    {
+        for(int k = 0; k < 12; k++)
+        {
+            x0s.push_back(job->x_range.center());
+            y0s.push_back(job->y_range.lower + (k + 0.5)/12*job->y_range.size());
+        }
+    }
+    job->x0s = x0s;
+    job->y0s = y0s;
+
+    //Create an empty curve for every solution, the points are added while they are computed
+    QPen linePen;
+    linePen.setColor(qs[ind_color_num]);
+    linePen.setWidth(2);
+    for(int seed = 0; seed < (int)x0s.size(); seed++)
+    {
+        QCPCurve *curve = new QCPCurve(plot->xAxis, plot->yAxis);
+        curve->setPen(linePen);
+        job->curves.append(curve);
+        job->seeds.append(seed);
+    }
+    job->pending.resize(job->seeds.size());
+
+    //Solve all initial conditions in parallel, and move the new points to the curves about 30 times a second
+    QFutureWatcher<void> *watcher = new QFutureWatcher<void>(this);
+    QTimer *timer = new QTimer(this);
+    connect(timer, &QTimer::timeout, this, [job, watcher, timer, plot]()
+    {
+        //Whether the solving is done is checked before taking the points, so no points are left behind
+        bool finished = watcher->isFinished();
+
+        QVector<QVector<QCPCurveData>> points(job->seeds.size());
+        {
+            QMutexLocker locker(&job->mutex);
+            points.swap(job->pending);
+        }
+
+        //The curves may have been removed by a reset in the meantime
+        for(int seed = 0; seed < points.size(); seed++)
+        {
+            if(!points[seed].isEmpty() && job->curves[seed])
+            {
+                job->curves[seed]->data()->add(points[seed]);
+            }
+        }
+        plot->replot(QCustomPlot::rpQueuedReplot);
+
+        if(finished)
+        {
+            timer->stop();
+            timer->deleteLater();
+            watcher->deleteLater();
+        }
+    });
+    watcher->setFuture(QtConcurrent::map(job->seeds, [job](const int &seed) { solve_ode_seed(*job, seed); }));
+    timer->start(30);
+
+    //Set the history label to the equation
+    ui->historie->setText(historie);
+
+    //The index of the color being used goes up, and is reset if it goes out of bounds
+    ind_color_num++;
+    if(ind_color_num == 10)
+    {
+        ind_color_num = 0;
     }
+}
 
 void MainWindow::input_pressed()
 {
@@ -179,46 +1131,49 @@ void MainWindow::input_pressed()
     //Try and process the input
     try {
         //Create an inputhandler with the input from "lineInput"
-        InputHandler ih(inputVal.toStdString().c_str());
+        InputHandler ih(inputVal.toStdString().c_str(), symbol_table.symbol_map());
 
-        //If the input has the vector indentifier...
-        if(ih.inp_kind == InputKind::vect)
+        //If the input is a definition, define it and draw the plots that use it again
+        if (ih.inp_kind == InputKind::definition)
         {
-            //Evaluate the vector and create a string with just the expression
-            Vector_N<2> res = ih.evaluate_vec();
-            std::string from = "(";
-            std::string to = ")";
-            std::string str = inputVal.toStdString().c_str();
-            std::string token = str.substr(str.find(from)+1,str.find(to));
-            token.pop_back();
-
-            //Set the history variable to the expression and plot the function
-            historie = QString::fromStdString(token);
-            draw_vec(res);
+            std::string name, param, body;
+            ih.read_definition(name, param, body);
+            std::vector<std::string> changed = symbol_table.define(name, param, body);
+            redraw_dependents(changed);
+
+            //Set the history label to the definition
+            historie = inputVal;
+            ui->historie->setText(historie);
+            return;
         }
 
-        //If the input has the function indentifier...
-        if (ih.inp_kind == InputKind::func)
+        //If the input is a slider, show a slider that sets its number
+        if (ih.inp_kind == InputKind::slider)
         {
-            //Evaluate the function and create a string with just the expression
-            std::vector<Vector_N<2>> res = ih.evaluate_func(x_min, x_max, func_spacing);
-            std::string from = "(";
-            std::string to = ")";
-            std::string str = inputVal.toStdString().c_str();
-            std::string token = str.substr(str.find(from)+1,str.back());
-            token.pop_back();
+            double from, to;
+            std::string name = ih.read_slider(from, to);
+            add_slider(name, from, to);
+
+            historie = inputVal;
+            ui->historie->setText(historie);
+            return;
+        }
 
-            //Set the history variable to the expression and plot the function
-            historie = QString::fromStdString(token);
-            draw_func(res);
+        //An input that doesn't use any definitions is just drawn, otherwise it is remembered so it can be drawn again
+        std::set<std::string> uses = symbol_table.uses(ih.content());
+        if (uses.empty())
+        {
+            process_input(inputVal);
+            return;
         }
 
-        //If the input has the point identifier...
-        if (ih.inp_kind == InputKind::point)
+        std::shared_ptr<PlotRecord> record(new PlotRecord);
+        record->input = inputVal;
+        record->color = ind_color_num;
+        draw_record(record);
+        for(const std::string &name : uses)
         {
-            //Evaluate the expression and plot the point
-            Vector_N<2> res = ih.evaluate_vec();
-            draw_point(res);
+            plots_using[name].push_back(record);
         }
 
       //Catch the exception if the processing of the input fails
@@ -233,6 +1188,495 @@ void MainWindow::input_pressed()
     }
 }
 
+void MainWindow::draw_record(std::shared_ptr<PlotRecord> record)
+{
+    //Whatever is on the plot after the input has been drawn, and wasn't there before, belongs to it
+    QCustomPlot *plot = ui->customPlot;
+    QSet<QCPAbstractPlottable *> old_plottables;
+    QSet<QCPAbstractItem *> old_items;
+    for(int i = 0; i < plot->plottableCount(); i++)
+    {
+        old_plottables.insert(plot->plottable(i));
+    }
+    for(int i = 0; i < plot->itemCount(); i++)
+    {
+        old_items.insert(plot->item(i));
+    }
+
+    process_input(record->input);
+
+    record->plottables.clear();
+    record->items.clear();
+    for(int i = 0; i < plot->plottableCount(); i++)
+    {
+        if(!old_plottables.contains(plot->plottable(i)))
+        {
+            record->plottables.append(plot->plottable(i));
+        }
+    }
+    for(int i = 0; i < plot->itemCount(); i++)
+    {
+        if(!old_items.contains(plot->item(i)))
+        {
+            record->items.append(plot->item(i));
+        }
+    }
+}
+
+void MainWindow::redraw_dependents(const std::vector<std::string> &changed)
+{
+    //The derivatives of functions that use a changed definition have to be made again
+    for(auto chain = derivative_chains.begin(); chain != derivative_chains.end();)
+    {
+        std::set<std::string> uses = symbol_table.uses(chain->first);
+        bool outdated = std::any_of(changed.begin(), changed.end(), [&uses](const std::string &name) { return uses.count(name) > 0; });
+        chain = outdated ? derivative_chains.erase(chain) : std::next(chain);
+    }
+
+    //Find every input that uses a changed definition, once even if it uses several of them
+    std::vector<std::shared_ptr<PlotRecord>> records;
+    std::set<PlotRecord *> found;
+    for(const std::string &name : changed)
+    {
+        for(const std::shared_ptr<PlotRecord> &record : plots_using[name])
+        {
+            if(found.insert(record.get()).second)
+            {
+                records.push_back(record);
+            }
+        }
+    }
+
+    //Remove what each of them drew and draw it again in its own color. The history label is set back afterwards
+    QCustomPlot *plot = ui->customPlot;
+    QString old_historie = historie;
+    int old_color_num = ind_color_num;
+    for(const std::shared_ptr<PlotRecord> &record : records)
+    {
+        for(const QPointer<QCPAbstractPlottable> &plottable : record->plottables)
+        {
+            if(plottable)
+            {
+                plot->removePlottable(plottable);
+            }
+        }
+        for(const QPointer<QCPAbstractItem> &item : record->items)
+        {
+            if(item)
+            {
+                plot->removeItem(item);
+            }
+        }
+        record->plottables.clear();
+        record->items.clear();
+        ind_plot = plot->graphCount();
+        ind_color_num = record->color;
+
+        //If the input can't be drawn with the new definitions it stays removed, until they change again
+        try {
+            draw_record(record);
+        } catch (std::exception& e)
+        {
+        }
+    }
+    historie = old_historie;
+    ind_color_num = old_color_num;
+    ui->historie->setText(historie);
+    plot->replot();
+}
+
+void MainWindow::add_slider(const std::string &name, double from, double to)
+{
+    //The number is defined as the lower limit if it isn't defined yet, a function can't get a slider
+    const SymbolMap &symbols = *symbol_table.symbol_map();
+    auto symbol = symbols.find(name);
+    if(symbol != symbols.end() && symbol->second.is_function)
+    {
+        throw InvalidDefinition();
+    }
+    if(symbol == symbols.end())
+    {
+        redraw_dependents(symbol_table.set_number(name, from));
+    }
+    double value = qBound(from, symbols.at(name).value, to);
+
+    //A slider for the same number gets the new limits, otherwise a new one is put in the empty grid above the history
+    std::shared_ptr<SliderState> &state = sliders[name];
+    if(!state || !state->slider)
+    {
+        state = std::make_shared<SliderState>();
+        state->name = name;
+        state->label = new QLabel(this);
+        state->slider = new QSlider(Qt::Horizontal, this);
+        state->slider->setRange(0, slider_steps);
+        state->frame_timer = new QTimer(state->slider);
+        state->frame_timer->setInterval(frame_ms);
+
+        int row = ui->gridLayout_2->rowCount();
+        ui->gridLayout_2->addWidget(state->label, row, 0);
+        ui->gridLayout_2->addWidget(state->slider, row, 1);
+
+        SliderState *s = state.get();
+        connect(state->slider, &QSlider::valueChanged, state->slider, [this, s](int position)
+        {
+            s->value = s->from + (s->to - s->from) * position / slider_steps;
+            s->label->setText(QString::fromStdString(s->name) + " = " + QString::number(s->value));
+
+            //While it is dragged the newest value waits for the next frame, otherwise it is applied right away
+            s->pending = true;
+            if(!s->slider->isSliderDown())
+            {
+                slider_released(s);
+            }
+        });
+        connect(state->slider, &QSlider::sliderPressed, state->slider, [this, s]() { slider_pressed(s); });
+        connect(state->slider, &QSlider::sliderReleased, state->slider, [this, s]() { slider_released(s); });
+        connect(state->frame_timer, &QTimer::timeout, state->slider, [this, s]() { slider_frame(s); });
+    }
+
+    //Move the slider to the value without applying it, since the number already has it
+    state->from = from;
+    state->to = to;
+    state->value = value;
+    state->slider->blockSignals(true);
+    state->slider->setValue(qRound((value - from) / (to - from) * slider_steps));
+    state->slider->blockSignals(false);
+    state->label->setText(QString::fromStdString(name) + " = " + QString::number(value));
+}
+
+void MainWindow::slider_pressed(SliderState *state)
+{
+    //Compile the graphs of F(...) that use the number, or a definition that depends on it, for drawing them every frame
+    const SymbolMap &symbols = *symbol_table.symbol_map();
+    std::set<PlotRecord *> found;
+    state->live.clear();
+    for(const std::string &name : symbol_table.dependents(state->name))
+    {
+        for(const std::shared_ptr<PlotRecord> &record : plots_using[name])
+        {
+            if(!found.insert(record.get()).second || !record->input.startsWith("F(") || record->plottables.isEmpty())
+            {
+                continue;
+            }
+            QCPGraph *graph = qobject_cast<QCPGraph *>(record->plottables.first().data());
+            if(!graph)
+            {
+                continue;
+            }
+
+            //The graph keeps its points, except the breaks at asymptotes, which can move with the number
+            InputHandler ih(record->input.toStdString().c_str(), &symbols);
+            std::shared_ptr<LiveGraph> live = std::make_shared<LiveGraph>(ih.compile_expr());
+            live->graph = graph;
+            for(auto point = graph->data()->constBegin(); point != graph->data()->constEnd(); ++point)
+            {
+                if(!qIsNaN(point->value))
+                {
+                    live->xs.append(point->key);
+                }
+            }
+            state->live.push_back(live);
+        }
+    }
+
+    state->stride = 1;
+    state->moved = false;
+    state->frame_timer->start();
+}
+
+void MainWindow::slider_frame(SliderState *state)
+{
+    //Nothing to do if the slider hasn't moved since the last frame
+    if(!state->pending)
+    {
+        return;
+    }
+    state->pending = false;
+
+    QElapsedTimer frame;
+    frame.start();
+
+    //A value that a definition depending on the number can't have is skipped
+    std::vector<std::string> changed;
+    try {
+        changed = symbol_table.set_number(state->name, state->value);
+    } catch (std::exception& e)
+    {
+        return;
+    }
+    state->moved = true;
+
+    //Bind the new values of the changed numbers and evaluate every stride'th point of the graphs, and the last one
+    const SymbolMap &symbols = *symbol_table.symbol_map();
+    for(const std::shared_ptr<LiveGraph> &live : state->live)
+    {
+        if(!live->graph || live->xs.isEmpty())
+        {
+            continue;
+        }
+        for(const std::string &name : changed)
+        {
+            if(!symbols.at(name).is_function)
+            {
+                live->expr.bind(name, symbols.at(name).value);
+            }
+        }
+
+        QVector<double> keys, values;
+        for(int i = 0; i < live->xs.size(); i += state->stride)
+        {
+            keys.append(live->xs[i]);
+        }
+        if((live->xs.size() - 1) % state->stride != 0)
+        {
+            keys.append(live->xs.last());
+        }
+        eval_parallel(live->expr, keys, values);
+        live->graph->setData(keys, values, true);
+    }
+    ui->customPlot->replot(QCustomPlot::rpImmediateRefresh);
+
+    //Draw fewer points in the next frame if this one went over its budget, and more again when there is time to spare
+    qint64 elapsed = frame.elapsed();
+    if(elapsed > frame_ms && state->stride < max_stride)
+    {
+        state->stride *= 2;
+    }
+    else if(elapsed < frame_ms / 4 && state->stride > 1)
+    {
+        state->stride /= 2;
+    }
+}
+
+void MainWindow::slider_released(SliderState *state)
+{
+    state->frame_timer->stop();
+    state->live.clear();
+    if(!state->pending && !state->moved)
+    {
+        return;
+    }
+    state->pending = false;
+    state->moved = false;
+
+    //Draw everything that uses the number again at full resolution, with the breaks at asymptotes. If the value
+    //isn't possible, the number keeps the last one that was
+    try {
+        redraw_dependents(symbol_table.set_number(state->name, state->value));
+    } catch (std::exception& e)
+    {
+        redraw_dependents(symbol_table.dependents(state->name));
+    }
+}
+
+void MainWindow::process_input(const QString &inputVal)
+{
+    //Create an inputhandler with the input, which can use the definitions
+    InputHandler ih(inputVal.toStdString().c_str(), symbol_table.symbol_map());
+
+    //If the input has the vector indentifier...
+    if(ih.inp_kind == InputKind::vect)
+    {
+        //Evaluate the vector and create a string with just the expression
+        Vector_N<2> res = ih.evaluate_vec();
+        std::string from = "(";
+        std::string to = ")";
+        std::string str = inputVal.toStdString().c_str();
+        std::string token = str.substr(str.find(from)+1,str.find(to));
+        token.pop_back();
+
+        //Set the history variable to the expression and plot the function
+        historie = QString::fromStdString(token);
+        draw_vec(res);
+    }
+
+    //If the input has the function indentifier...
+    if (ih.inp_kind == InputKind::func)
+    {
+        //Evaluate the function on the grid it shares with the other graphs, and create a string with just the expression
+        CompiledExpr expr = ih.compile_expr();
+        std::vector<double> xs, ys;
+        int root = eval_on_shared_grid(expr, xs, ys);
+        std::vector<Vector_N<2>> res = InputHandler::graph_points(expr, xs, ys);
+        std::string from = "(";
+        std::string to = ")";
+        std::string str = inputVal.toStdString().c_str();
+        std::string token = str.substr(str.find(from)+1,str.back());
+        token.pop_back();
+
+        //Set the history variable to the expression and plot the function
+        historie = QString::fromStdString(token);
+        QCPGraph *graph = draw_func(res);
+        shared_grid->graphs.push_back(std::make_pair(QPointer<QCPGraph>(graph), root));
+    }
+
+    //If the input has the derivative identifier...
+    if (ih.inp_kind == InputKind::derivative)
+    {
+        //Find the derivatives of the function, or parse it if it hasn't been differentiated before
+        size_t order;
+        std::string func = ih.derivative_func(order);
+        std::shared_ptr<DerivativeChain> &chain = derivative_chains[func];
+        if(!chain)
+        {
+            chain = std::make_shared<DerivativeChain>(CompiledExpr(func, symbol_table.symbol_map()));
+        }
+
+        //Set the history variable to the function with a mark for every derivative and plot it
+        historie = QString::fromStdString("(" + func + ")" + std::string(order, '\''));
+        draw_graph(chain->get(order));
+    }
+
+    //If the input has the roots, extrema or intersections identifier...
+    if (ih.inp_kind == InputKind::zeros || ih.inp_kind == InputKind::extrema || ih.inp_kind == InputKind::intersections)
+    {
+        //Compile the function, or both functions for intersections, and create a string with just the expressions
+        std::string str = inputVal.toStdString().c_str();
+        std::string token = str.substr(str.find("(")+1);
+        token.pop_back();
+
+        //Set the history variable to the expressions and mark the features in the visible part of the plot
+        historie = QString::fromStdString(token);
+        if (ih.inp_kind == InputKind::intersections)
+        {
+            draw_features(ih.compile_pair(), false);
+        }
+        else
+        {
+            draw_features(std::vector<CompiledExpr>(1, ih.compile_expr()), ih.inp_kind == InputKind::extrema);
+        }
+    }
+
+    //If the input has the integral identifier...
+    if (ih.inp_kind == InputKind::integral)
+    {
+        //Compile the function and read the limits, and create a string with just the expression
+        double from, to;
+        CompiledExpr expr = ih.compile_integral(from, to);
+        std::string str = inputVal.toStdString().c_str();
+        std::string token = str.substr(str.find("(")+1);
+        token.pop_back();
+
+        //Set the history variable to the expression and shade the area
+        historie = QString::fromStdString(token);
+        draw_integral(expr, from, to);
+    }
+
+    //If the input has the heatmap identifier...
+    if (ih.inp_kind == InputKind::field)
+    {
+        //Compile the expression once so it can be evaluated for every cell of the heatmap
+        CompiledExpr expr = ih.compile_expr();
+        std::string str = inputVal.toStdString().c_str();
+        std::string token = str.substr(str.find("(")+1);
+        token.pop_back();
+
+        //Set the history variable to the expression and plot the heatmap
+        historie = QString::fromStdString(token);
+        draw_field(expr);
+    }
+
+    //If the input has the implicit curve identifier...
+    if (ih.inp_kind == InputKind::implicit)
+    {
+        //Compile the equation once so it can be evaluated all over the visible region
+        CompiledExpr expr = ih.compile_equation();
+        std::string str = inputVal.toStdString().c_str();
+        std::string token = str.substr(str.find("(")+1);
+        token.pop_back();
+
+        //Set the history variable to the equation and plot the curve
+        historie = QString::fromStdString(token);
+        draw_implicit(expr);
+    }
+
+    //If the input has the contour identifier...
+    if (ih.inp_kind == InputKind::contour)
+    {
+        //Compile the expression once so it can be evaluated for every point of the grid
+        CompiledExpr expr = ih.compile_expr();
+        std::string str = inputVal.toStdString().c_str();
+        std::string token = str.substr(str.find("(")+1);
+        token.pop_back();
+
+        //Set the history variable to the expression and plot the contour lines
+        historie = QString::fromStdString(token);
+        draw_contour(expr);
+    }
+
+    //If the input has the parametric curve identifier...
+    if (ih.inp_kind == InputKind::parametric)
+    {
+        //Compile both components once so they can be evaluated for every value of t
+        double t_min, t_max;
+        std::vector<CompiledExpr> components = ih.compile_parametric(t_min, t_max);
+        std::string str = inputVal.toStdString().c_str();
+        std::string token = str.substr(str.find("(")+1);
+        token.pop_back();
+
+        //Set the history variable to the curve and plot it
+        historie = QString::fromStdString(token);
+        draw_parametric(components[0], components[1], t_min, t_max);
+    }
+
+    //If the input has the polar curve identifier...
+    if (ih.inp_kind == InputKind::polar)
+    {
+        //Compile the radius once so it can be evaluated for every angle
+        double theta_min, theta_max;
+        CompiledExpr expr = ih.compile_polar(theta_min, theta_max);
+        std::string str = inputVal.toStdString().c_str();
+        std::string token = str.substr(str.find("(")+1);
+        token.pop_back();
+
+        //Set the history variable to the curve and plot it
+        historie = QString::fromStdString(token);
+        draw_polar(expr, theta_min, theta_max);
+    }
+
+    //If the input has the slope field identifier...
+    if (ih.inp_kind == InputKind::slope)
+    {
+        //Compile the right hand side once so it can be evaluated for the whole lattice at once
+        CompiledExpr expr = ih.compile_slope();
+        std::string str = inputVal.toStdString().c_str();
+        std::string token = str.substr(str.find("(")+1);
+        token.pop_back();
+
+        //Set the history variable to the equation and plot the slope field. Double clicking the plot then draws solutions
+        historie = QString::fromStdString(token);
+        last_ode.reset(new CompiledExpr(expr));
+        last_ode_method = dormand_prince;
+        draw_slope_field(expr);
+    }
+
+    //If the input has the differential equation identifier...
+    if (ih.inp_kind == InputKind::ode)
+    {
+        //Compile the right hand side once, the solver evaluates it many times for every solution
+        std::vector<double> x0s, y0s;
+        ODEMethod method;
+        CompiledExpr expr = ih.compile_ode(x0s, y0s, method);
+        std::string str = inputVal.toStdString().c_str();
+        std::string token = str.substr(str.find("(")+1);
+        token.pop_back();
+
+        //Set the history variable to the equation and plot the solutions
+        historie = QString::fromStdString(token);
+        last_ode.reset(new CompiledExpr(expr));
+        last_ode_method = method;
+        draw_ode_solutions(expr, method, x0s, y0s);
+    }
+
+    //If the input has the point identifier...
+    if (ih.inp_kind == InputKind::point)
+    {
+        //Evaluate the expression and plot the point
+        Vector_N<2> res = ih.evaluate_vec();
+        draw_point(res);
+    }
+}
+
 void MainWindow::min_x()
 {
     //Make a pointer to the lineedit with the name "xMin" and save the text inside it to a variable
@@ -319,11 +1763,40 @@ void MainWindow::plot_reset()
 {
     //Reset the plot, remove the history text and set the variable "ind_plot" to 0
     ui->customPlot->clearItems();
-    ui->customPlot->clearGraphs();
+    ui->customPlot->clearPlottables();
+    plots_using.clear();
+    last_ode.reset();
+
+    //Remove the sliders, their timers go with them, and forget the derivatives
+    for(const auto &slider : sliders)
+    {
+        if(slider.second->frame_timer)
+        {
+            slider.second->frame_timer->stop();
+        }
+        delete slider.second->slider;
+        delete slider.second->label;
+    }
+    sliders.clear();
+    derivative_chains.clear();
+
     ui->customPlot->replot();
     ui->historie->setText("");
     ind_plot = 0;
 }
+void MainWindow::plot_double_clicked(QMouseEvent *event)
+{
+    //Double clicking the plot draws the solution of the last differential equation through that point
+    if(!last_ode)
+    {
+        return;
+    }
+
+    std::vector<double> x0s(1, ui->customPlot->xAxis->pixelToCoord(event->pos().x()));
+    std::vector<double> y0s(1, ui->customPlot->yAxis->pixelToCoord(event->pos().y()));
+    draw_ode_solutions(*last_ode, last_ode_method, x0s, y0s);
+}
+
 void MainWindow::draw_point(Vector_N<2> point)
 {
     //Create a vector and set the x and y to the input
@@ -2,7 +2,17 @@
 #define MAINWINDOW_H
 
 #include <QMainWindow>
+#include <memory>
+#include <string>
+#include <vector>
 #include "Matrix_NxN.h"
+#include "ODESolver.h"
+
+class CompiledExpr;
+class QCPGraph;
+class CurveSampler;
+struct PlotRecord;
+struct SliderState;
 
 QT_BEGIN_NAMESPACE
 namespace Ui { class MainWindow; }
@@ -18,15 +28,34 @@ public:
 
 private:
     Ui::MainWindow *ui;
+    void draw_field(const CompiledExpr &expr);
+    void draw_implicit(const CompiledExpr &expr);
+    void draw_contour(const CompiledExpr &expr);
+    void draw_parametric(const CompiledExpr &fx, const CompiledExpr &fy, double t_min, double t_max);
+    void draw_polar(const CompiledExpr &fr, double theta_min, double theta_max);
+    void draw_sampled_curve(const CurveSampler &curve);
+    void draw_slope_field(const CompiledExpr &expr);
+    void draw_ode_solutions(const CompiledExpr &expr, ODEMethod method, std::vector<double> x0s, std::vector<double> y0s);
+    void draw_graph(const CompiledExpr &expr);
+    void draw_features(const std::vector<CompiledExpr> &funcs, bool extrema);
+    void draw_integral(const CompiledExpr &expr, double from, double to);
+    void process_input(const QString &inputVal);
+    void draw_record(std::shared_ptr<PlotRecord> record);
+    void redraw_dependents(const std::vector<std::string> &changed);
+    void add_slider(const std::string &name, double from, double to);
+    void slider_pressed(SliderState *state);
+    void slider_frame(SliderState *state);
+    void slider_released(SliderState *state);
 private slots:
     void draw_vec(Vector_N<2>);
-    void draw_func(std::vector<Vector_N<2>>);
+    QCPGraph *draw_func(std::vector<Vector_N<2>>);
     void draw_point(Vector_N<2>);
     void input_pressed();
     void min_x();
     void max_x();
     void change_spacing();
     void plot_reset();
+    void plot_double_clicked(QMouseEvent *event);
     bool isNum(std::string);
 };
 #endif // MAINWINDOW_H
@@ -65,6 +65,8 @@
 #include <QtCore/QStack>
 #include <QtCore/QCache>
 #include <QtCore/QMargins>
+#include <QtCore/QThreadPool>
+#include <QtCore/QFutureWatcher>
 #include <qmath.h>
 #include <limits>
 #include <algorithm>
@@ -85,10 +87,12 @@
 #  include <QtGui/QWidget>
 #  include <QtGui/QPrinter>
 #  include <QtGui/QPrintEngine>
+#  include <QtCore/QtConcurrentMap>
 #else
 #  include <QtNumeric>
 #  include <QtWidgets/QWidget>
 #  include <QtPrintSupport/QtPrintSupport>
+#  include <QtConcurrent/QtConcurrentMap>
 #endif
 
 class QCPPainter;
@@ -243,6 +247,8 @@ enum PlottingHint { phNone              = 0x000 ///< <tt>0x000</tt> No hints are
                     ,phImmediateRefresh = 0x002 ///< <tt>0x002</tt> causes an immediate repaint() instead of a soft update() when QCustomPlot::replot() is called with parameter \ref QCustomPlot::rpRefreshHint.
                                                 ///<                This is set by default to prevent the plot from freezing on fast consecutive replots (e.g. user drags ranges with mouse).
                     ,phCacheLabels      = 0x004 ///< <tt>0x004</tt> axis (tick) labels will be cached as pixmaps, increasing replot performance.
+                    ,phIncrementalReplot = 0x008 ///< <tt>0x008</tt> QCustomPlot::replot only redraws the paint buffers whose layers changed since the last replot. Layerables appended to a
+                                                 ///<                \ref QCPLayer::lmBuffered layer are drawn on top of the existing buffer contents (see \ref QCPLayerable::captureDrawState).
                   };
 Q_DECLARE_FLAGS(PlottingHints, PlottingHint)
 
@@ -679,10 +685,13 @@ protected:
   
   // non-property members:
   QWeakPointer<QCPAbstractPaintBuffer> mPaintBuffer;
+  QList<QByteArray> mDrawnStates;
   
   // non-virtual methods:
-  void draw(QCPPainter *painter);
-  void drawToPaintBuffer();
+  void draw(QCPPainter *painter, int firstChild=0);
+  void drawToPaintBuffer(int firstChild=0);
+  QList<QByteArray> captureDrawStates() const;
+  int firstChangedChild(const QList<QByteArray> &states) const;
   void addChild(QCPLayerable *layerable, bool prepend);
   void removeChild(QCPLayerable *layerable);
   
@@ -744,6 +753,7 @@ protected:
   virtual QRect clipRect() const;
   virtual void applyDefaultAntialiasingHint(QCPPainter *painter) const = 0;
   virtual void draw(QCPPainter *painter) = 0;
+  virtual bool captureDrawState(QDataStream &stream) const;
   // selection events:
   virtual void selectEvent(QMouseEvent *event, bool additive, const QVariant &details, bool *selectionStateChanged);
   virtual void deselectEvent(bool *selectionStateChanged);
@@ -759,6 +769,7 @@ protected:
   void setParentLayerable(QCPLayerable* parentLayerable);
   bool moveToLayer(QCPLayer *layer, bool prepend);
   void applyAntialiasingHint(QCPPainter *painter, bool localAntialiased, QCP::AntialiasedElement overrideElement) const;
+  static void captureAxisState(QDataStream &stream, const QCPAxis *axis);
   
 private:
   Q_DISABLE_COPY(QCPLayerable)
@@ -1307,6 +1318,9 @@ public:
   void clear();
   
 protected:
+  // reimplemented virtual methods:
+  virtual bool captureDrawState(QDataStream &stream) const Q_DECL_OVERRIDE;
+  
   // introduced virtual methods:
   virtual void updateLayout();
   
@@ -1907,6 +1921,7 @@ protected:
   // reimplemented virtual methods:
   virtual void applyDefaultAntialiasingHint(QCPPainter *painter) const Q_DECL_OVERRIDE;
   virtual void draw(QCPPainter *painter) Q_DECL_OVERRIDE;
+  virtual bool captureDrawState(QDataStream &stream) const Q_DECL_OVERRIDE;
   
   // non-virtual methods:
   void drawGridLines(QCPPainter *painter) const;
@@ -2114,6 +2129,7 @@ public:
   void rescale(bool onlyVisiblePlottables=false);
   double pixelToCoord(double value) const;
   double coordToPixel(double value) const;
+  bool linearPixelTransform(double &factor, double &offset) const;
   SelectablePart getPartAt(const QPointF &pos) const;
   QList<QCPAbstractPlottable*> plottables() const;
   QList<QCPGraph*> graphs() const;
@@ -2376,6 +2392,7 @@ public:
   void applyTo(QCPPainter *painter, const QPen &defaultPen) const;
   void drawShape(QCPPainter *painter, const QPointF &pos) const;
   void drawShape(QCPPainter *painter, double x, double y) const;
+  void captureDrawState(QDataStream &stream) const;
 
 protected:
   // property members:
@@ -2400,6 +2417,109 @@ Q_DECLARE_METATYPE(QCPScatterStyle::ScatterShape)
 /* including file 'src/datacontainer.h', size 4596                           */
 /* commit ce344b3f96a62e5f652585e55f1ae7c7883cd45b 2018-06-25 01:03:39 +0200 */
 
+class QCP_LIB_DECL QCPRangeWindow
+{
+public:
+  QCPRangeWindow();
+  
+  // getters:
+  int size() const { return int(mEnd-mBegin); }
+  bool isEmpty() const { return mEnd == mBegin; }
+  
+  // non-virtual methods:
+  void clear();
+  void append(double lower, double upper);
+  void removeFirst(int count);
+  void collapse();
+  QCPRange range(bool &foundRange) const;
+  
+protected:
+  struct Entry
+  {
+    qint64 index;
+    double value;
+  };
+  
+  // non-property members:
+  qint64 mBegin, mEnd;
+  QVector<Entry> mLowerQueue, mUpperQueue;
+  int mLowerHead, mUpperHead;
+  
+  // non-virtual methods:
+  void compact(QVector<Entry> &queue, int &head) const;
+};
+
+class QCP_LIB_DECL QCPDataColumns
+{
+  Q_GADGET
+public:
+  /*!
+    Defines the type in which the values of a \ref QCPDataColumns instance are stored.
+    
+    \see setValuePrecision
+  */
+  enum ValuePrecision { vpDouble ///< values are stored as double, like in \ref QCPDataContainer
+                        ,vpSingle ///< values are stored as float, which halves the memory and the bandwidth of value scans at the cost of precision
+                      };
+  Q_ENUMS(ValuePrecision)
+  
+  explicit QCPDataColumns(ValuePrecision precision=vpDouble);
+  
+  // getters:
+  int size() const { return mKeys.size(); }
+  bool isEmpty() const { return mKeys.isEmpty(); }
+  ValuePrecision valuePrecision() const { return mValuePrecision; }
+  bool keysSorted() const { return mKeysSorted; }
+  int revision() const { return mRevision; }
+  double key(int index) const { return mKeys.at(index); }
+  double value(int index) const { return mValuePrecision == vpSingle ? double(mSingleValues.at(index)) : mValues.at(index); }
+  const double *keyData() const { return mKeys.constData(); }
+  
+  // setters:
+  void setValuePrecision(ValuePrecision precision);
+  
+  // non-virtual methods:
+  void set(const QVector<double> &keys, const QVector<double> &values);
+  void add(const QVector<double> &keys, const QVector<double> &values);
+  void add(double key, double value);
+  void clear();
+  void sort();
+  int findBegin(double key, bool expandedRange=true) const;
+  int findEnd(double key, bool expandedRange=true) const;
+  QCPRange keyRange(bool &foundRange, QCP::SignDomain signDomain=QCP::sdBoth) const;
+  QCPRange valueRange(bool &foundRange, QCP::SignDomain signDomain=QCP::sdBoth, const QCPRange &inKeyRange=QCPRange()) const;
+  QCPRange valueRange(const QCPDataRange &dataRange, bool &foundRange, QCP::SignDomain signDomain=QCP::sdBoth) const;
+  QCPDataRange dataRange() const { return QCPDataRange(0, size()); }
+  
+protected:
+  struct RangeCache
+  {
+    QCPRange range;
+    bool foundRange;
+    int revision; // the range is valid while this is equal to mRevision
+  };
+  
+  // property members:
+  ValuePrecision mValuePrecision;
+  
+  // non-property members:
+  QVector<double> mKeys;
+  QVector<double> mValues; // used if mValuePrecision is vpDouble
+  QVector<float> mSingleValues; // used if mValuePrecision is vpSingle
+  bool mKeysSorted;
+  int mRevision;
+  mutable RangeCache mKeyRangeCache[3], mValueRangeCache[3]; // indexed by QCP::SignDomain
+  
+  // non-virtual methods:
+  void updateRevision();
+  void appendValues(const double *values, int count);
+  void updateRangeCaches(int previousRevision, const QCPDataRange &appended);
+  QCPRange scanKeyRange(const QCPDataRange &dataRange, bool &foundRange, QCP::SignDomain signDomain) const;
+  template <typename T> static QCPRange scanValueRange(const T *data, const QCPDataRange &dataRange, bool &foundRange, QCP::SignDomain signDomain);
+  static void uniteRange(QCPRange &range, bool &foundRange, const QCPRange &other, bool otherFound);
+};
+Q_DECLARE_METATYPE(QCPDataColumns::ValuePrecision)
+
 /*! \relates QCPDataContainer
   Returns whether the sort key of \a a is less than the sort key of \a b.
 
@@ -2421,9 +2541,12 @@ public:
   int size() const { return mData.size()-mPreallocSize; }
   bool isEmpty() const { return size() == 0; }
   bool autoSqueeze() const { return mAutoSqueeze; }
+  int ringCapacity() const { return mRingCapacity; }
+  int revision() const { return mRevision; }
   
   // setters:
   void setAutoSqueeze(bool enabled);
+  void setRingCapacity(int capacity);
   
   // non-virtual methods:
   void set(const QCPDataContainer<DataType> &data);
@@ -2441,8 +2564,8 @@ public:
   
   const_iterator constBegin() const { return mData.constBegin()+mPreallocSize; }
   const_iterator constEnd() const { return mData.constEnd(); }
-  iterator begin() { return mData.begin()+mPreallocSize; }
-  iterator end() { return mData.end(); }
+  iterator begin() { invalidateBounds(); updateRevision(); return mData.begin()+mPreallocSize; }
+  iterator end() { invalidateBounds(); updateRevision(); return mData.end(); }
   const_iterator findBegin(double sortKey, bool expandedRange=true) const;
   const_iterator findEnd(double sortKey, bool expandedRange=true) const;
   const_iterator at(int index) const { return constBegin()+qBound(0, index, size()); }
@@ -2454,15 +2577,28 @@ public:
 protected:
   // property members:
   bool mAutoSqueeze;
+  int mRingCapacity;
   
   // non-property memebers:
   QVector<DataType> mData;
   int mPreallocSize;
   int mPreallocIteration;
+  QCPRangeWindow mValueBounds[3], mKeyBounds[3]; // indexed by QCP::SignDomain
+  bool mBoundsValid, mBoundsOrdered;
+  int mRevision;
   
   // non-virtual methods:
   void preallocateGrow(int minimumPreallocSize);
   void performAutoSqueeze();
+  void updateRevision();
+  void trackBounds(const DataType &data);
+  void ensureBounds();
+  void clearBounds();
+  void boundsAppended(int count);
+  void boundsInserted(const_iterator begin, const_iterator end);
+  void boundsRemovedFirst(int count);
+  void invalidateBounds();
+  void enforceRingCapacity();
 };
 
 // include implementation in header since it is a class template:
@@ -2490,6 +2626,12 @@ protected:
   specifying that added data is already itself sorted by key, if he can guarantee that this is the
   case (see for example \ref add(const QVector<DataType> &data, bool alreadySorted)).
 
+  For streaming applications that only ever append new data and display a fixed number of the most
+  recent points (e.g. scrolling strip charts), a ring capacity can be set (\ref setRingCapacity).
+  Appending is then amortized O(1), the oldest points are dropped in O(1), and the value range of
+  the remaining points (\ref valueRange) is maintained incrementally instead of by scanning all
+  data.
+
   The data can be accessed with the provided const iterators (\ref constBegin, \ref constEnd). If
   it is necessary to alter existing data in-place, the non-const iterators can be used (\ref begin,
   \ref end). Changing data members that are not the sort key (for most data types called \a key) is
@@ -2553,6 +2695,12 @@ protected:
   Returns whether this container holds no data points.
 */
 
+/*! \fn int QCPDataContainer<DataType>::revision() const
+  
+  Returns a number that changes whenever the data in this container is modified. Comparing it with
+  a previously stored revision tells whether the data must be considered changed since then.
+*/
+
 /*! \fn QCPDataContainer::const_iterator QCPDataContainer<DataType>::constBegin() const
   
   Returns a const iterator to the first data point in this container.
@@ -2606,9 +2754,14 @@ protected:
 template <class DataType>
 QCPDataContainer<DataType>::QCPDataContainer() :
   mAutoSqueeze(true),
+  mRingCapacity(0),
   mPreallocSize(0),
-  mPreallocIteration(0)
+  mPreallocIteration(0),
+  mBoundsValid(true),
+  mBoundsOrdered(true),
+  mRevision(0)
 {
+  updateRevision();
 }
 
 /*!
@@ -2630,6 +2783,27 @@ void QCPDataContainer<DataType>::setAutoSqueeze(bool enabled)
   }
 }
 
+/*!
+  Sets the maximum number of data points this container holds. Whenever adding data makes the
+  container exceed \a capacity, the data points with the smallest sort keys are removed. Set \a
+  capacity to 0 (the default) for an unlimited container.
+
+  This turns the container into a ring buffer for streaming data, e.g. for a strip chart with a
+  fixed time window: New points are appended at the end (amortized O(1) if their keys are not
+  smaller than the existing ones), and evicted points are merely moved to the preallocation pool in
+  O(1), which is reclaimed with a single compacting copy once it grows larger than \a capacity.
+  The data stays contiguous, so iterators and \ref findBegin / \ref findEnd work unchanged.
+
+  As long as data is only appended and removed from the front (by the ring capacity or \ref
+  removeBefore), \ref valueRange is answered in O(1) from incrementally maintained bounds.
+*/
+template <class DataType>
+void QCPDataContainer<DataType>::setRingCapacity(int capacity)
+{
+  mRingCapacity = qMax(0, capacity);
+  enforceRingCapacity();
+}
+
 /*! \overload
   
   Replaces the current data in this container with the provided \a data.
@@ -2655,11 +2829,16 @@ void QCPDataContainer<DataType>::set(const QCPDataContainer<DataType> &data)
 template <class DataType>
 void QCPDataContainer<DataType>::set(const QVector<DataType> &data, bool alreadySorted)
 {
+  updateRevision();
   mData = data;
   mPreallocSize = 0;
   mPreallocIteration = 0;
-  if (!alreadySorted)
+  clearBounds();
+  if (!alreadySorted && !std::is_sorted(mData.constBegin(), mData.constEnd(), qcpLessThanSortKey<DataType>))
     sort();
+  else
+    boundsAppended(size());
+  enforceRingCapacity();
 }
 
 /*! \overload
@@ -2674,6 +2853,7 @@ void QCPDataContainer<DataType>::add(const QCPDataContainer<DataType> &data)
   if (data.isEmpty())
     return;
   
+  updateRevision();
   const int n = data.size();
   const int oldSize = size();
   
@@ -2682,14 +2862,20 @@ void QCPDataContainer<DataType>::add(const QCPDataContainer<DataType> &data)
     if (mPreallocSize < n)
       preallocateGrow(n);
     mPreallocSize -= n;
-    std::copy(data.constBegin(), data.constEnd(), begin());
+    std::copy(data.constBegin(), data.constEnd(), mData.begin()+mPreallocSize);
+    boundsInserted(data.constBegin(), data.constEnd());
   } else // don't need to prepend, so append and merge if necessary
   {
     mData.resize(mData.size()+n);
-    std::copy(data.constBegin(), data.constEnd(), end()-n);
+    std::copy(data.constBegin(), data.constEnd(), mData.end()-n);
     if (oldSize > 0 && !qcpLessThanSortKey<DataType>(*(constEnd()-n-1), *(constEnd()-n))) // if appended range keys aren't all greater than existing ones, merge the two partitions
-      std::inplace_merge(begin(), end()-n, end(), qcpLessThanSortKey<DataType>);
+    {
+      std::inplace_merge(mData.begin()+mPreallocSize, mData.end()-n, mData.end(), qcpLessThanSortKey<DataType>);
+      boundsInserted(data.constBegin(), data.constEnd());
+    } else
+      boundsAppended(n);
   }
+  enforceRingCapacity();
 }
 
 /*!
@@ -2705,6 +2891,10 @@ void QCPDataContainer<DataType>::add(const QVector<DataType> &data, bool already
 {
   if (data.isEmpty())
     return;
+  
+  updateRevision();
+  if (!alreadySorted) // checking is linear, so it pays off against sorting already sorted data
+    alreadySorted = std::is_sorted(data.constBegin(), data.constEnd(), qcpLessThanSortKey<DataType>);
   if (isEmpty())
   {
     set(data, alreadySorted);
@@ -2719,16 +2909,22 @@ void QCPDataContainer<DataType>::add(const QVector<DataType> &data, bool already
     if (mPreallocSize < n)
       preallocateGrow(n);
     mPreallocSize -= n;
-    std::copy(data.constBegin(), data.constEnd(), begin());
+    std::copy(data.constBegin(), data.constEnd(), mData.begin()+mPreallocSize);
+    boundsInserted(data.constBegin(), data.constEnd());
   } else // don't need to prepend, so append and then sort and merge if necessary
   {
     mData.resize(mData.size()+n);
-    std::copy(data.constBegin(), data.constEnd(), end()-n);
+    std::copy(data.constBegin(), data.constEnd(), mData.end()-n);
     if (!alreadySorted) // sort appended subrange if it wasn't already sorted
-      std::sort(end()-n, end(), qcpLessThanSortKey<DataType>);
+      std::sort(mData.end()-n, mData.end(), qcpLessThanSortKey<DataType>);
     if (oldSize > 0 && !qcpLessThanSortKey<DataType>(*(constEnd()-n-1), *(constEnd()-n))) // if appended range keys aren't all greater than existing ones, merge the two partitions
-      std::inplace_merge(begin(), end()-n, end(), qcpLessThanSortKey<DataType>);
+    {
+      std::inplace_merge(mData.begin()+mPreallocSize, mData.end()-n, mData.end(), qcpLessThanSortKey<DataType>);
+      boundsInserted(data.constBegin(), data.constEnd());
+    } else
+      boundsAppended(n);
   }
+  enforceRingCapacity();
 }
 
 /*! \overload
@@ -2740,20 +2936,25 @@ void QCPDataContainer<DataType>::add(const QVector<DataType> &data, bool already
 template <class DataType>
 void QCPDataContainer<DataType>::add(const DataType &data)
 {
+  updateRevision();
   if (isEmpty() || !qcpLessThanSortKey<DataType>(data, *(constEnd()-1))) // quickly handle appends if new data key is greater or equal to existing ones
   {
     mData.append(data);
+    boundsAppended(1);
   } else if (qcpLessThanSortKey<DataType>(data, *constBegin()))  // quickly handle prepends using preallocated space
   {
     if (mPreallocSize < 1)
       preallocateGrow(1);
     --mPreallocSize;
-    *begin() = data;
+    mData[mPreallocSize] = data;
+    boundsInserted(&data, &data+1);
   } else // handle inserts, maintaining sorted keys
   {
-    QCPDataContainer<DataType>::iterator insertionPoint = std::lower_bound(begin(), end(), data, qcpLessThanSortKey<DataType>);
-    mData.insert(insertionPoint, data);
+    const int insertionIndex = std::lower_bound(constBegin(), constEnd(), data, qcpLessThanSortKey<DataType>)-mData.constBegin();
+    mData.insert(insertionIndex, data);
+    boundsInserted(&data, &data+1);
   }
+  enforceRingCapacity();
 }
 
 /*!
@@ -2764,9 +2965,11 @@ void QCPDataContainer<DataType>::add(const DataType &data)
 template <class DataType>
 void QCPDataContainer<DataType>::removeBefore(double sortKey)
 {
-  QCPDataContainer<DataType>::iterator it = begin();
-  QCPDataContainer<DataType>::iterator itEnd = std::lower_bound(begin(), end(), DataType::fromSortKey(sortKey), qcpLessThanSortKey<DataType>);
+  updateRevision();
+  QCPDataContainer<DataType>::const_iterator it = constBegin();
+  QCPDataContainer<DataType>::const_iterator itEnd = std::lower_bound(constBegin(), constEnd(), DataType::fromSortKey(sortKey), qcpLessThanSortKey<DataType>);
   mPreallocSize += itEnd-it; // don't actually delete, just add it to the preallocated block (if it gets too large, squeeze will take care of it)
+  boundsRemovedFirst(itEnd-it);
   if (mAutoSqueeze)
     performAutoSqueeze();
 }
@@ -2779,6 +2982,7 @@ void QCPDataContainer<DataType>::removeBefore(double sortKey)
 template <class DataType>
 void QCPDataContainer<DataType>::removeAfter(double sortKey)
 {
+  updateRevision();
   QCPDataContainer<DataType>::iterator it = std::upper_bound(begin(), end(), DataType::fromSortKey(sortKey), qcpLessThanSortKey<DataType>);
   QCPDataContainer<DataType>::iterator itEnd = end();
   mData.erase(it, itEnd); // typically adds it to the postallocated block
@@ -2799,6 +3003,7 @@ void QCPDataContainer<DataType>::remove(double sortKeyFrom, double sortKeyTo)
   if (sortKeyFrom >= sortKeyTo || isEmpty())
     return;
   
+  updateRevision();
   QCPDataContainer<DataType>::iterator it = std::lower_bound(begin(), end(), DataType::fromSortKey(sortKeyFrom), qcpLessThanSortKey<DataType>);
   QCPDataContainer<DataType>::iterator itEnd = std::upper_bound(it, end(), DataType::fromSortKey(sortKeyTo), qcpLessThanSortKey<DataType>);
   mData.erase(it, itEnd);
@@ -2818,6 +3023,7 @@ void QCPDataContainer<DataType>::remove(double sortKeyFrom, double sortKeyTo)
 template <class DataType>
 void QCPDataContainer<DataType>::remove(double sortKey)
 {
+  updateRevision();
   QCPDataContainer::iterator it = std::lower_bound(begin(), end(), DataType::fromSortKey(sortKey), qcpLessThanSortKey<DataType>);
   if (it != end() && it->sortKey() == sortKey)
   {
@@ -2838,9 +3044,11 @@ void QCPDataContainer<DataType>::remove(double sortKey)
 template <class DataType>
 void QCPDataContainer<DataType>::clear()
 {
+  updateRevision();
   mData.clear();
   mPreallocIteration = 0;
   mPreallocSize = 0;
+  clearBounds();
 }
 
 /*!
@@ -2877,7 +3085,7 @@ void QCPDataContainer<DataType>::squeeze(bool preAllocation, bool postAllocation
   {
     if (mPreallocSize > 0)
     {
-      std::copy(begin(), end(), mData.begin());
+      std::copy(mData.constBegin()+mPreallocSize, mData.constEnd(), mData.begin());
       mData.resize(size());
       mPreallocSize = 0;
     }
@@ -2953,6 +3161,8 @@ typename QCPDataContainer<DataType>::const_iterator QCPDataContainer<DataType>::
   
   If the DataType reports that its main key is equal to the sort key (\a sortKeyIsMainKey), as is
   the case for most plottables, this method uses this fact and finds the range very quickly.
+  Otherwise, the range is taken from bounds the container maintains incrementally while data is
+  added and removed, so this method doesn't scan the data either (see \ref valueRange).
   
   \see valueRange
 */
@@ -2964,98 +3174,44 @@ QCPRange QCPDataContainer<DataType>::keyRange(bool &foundRange, QCP::SignDomain
     foundRange = false;
     return QCPRange();
   }
+  if (!DataType::sortKeyIsMainKey()) // main keys are unordered (e.g. QCPCurve), use the incrementally maintained bounds
+  {
+    ensureBounds();
+    return mKeyBounds[signDomain].range(foundRange);
+  }
+  
+  // DataType is sorted by main key (e.g. QCPGraph), so the range is spanned by the first and last
+  // key with non-NaN value in the sign domain. The sign domain boundaries are found by binary search:
   QCPRange range;
   bool haveLower = false;
   bool haveUpper = false;
-  double current;
-  
-  QCPDataContainer<DataType>::const_iterator it = constBegin();
+  QCPDataContainer<DataType>::const_iterator itBegin = constBegin();
   QCPDataContainer<DataType>::const_iterator itEnd = constEnd();
-  if (signDomain == QCP::sdBoth) // range may be anywhere
-  {
-    if (DataType::sortKeyIsMainKey()) // if DataType is sorted by main key (e.g. QCPGraph, but not QCPCurve), use faster algorithm by finding just first and last key with non-NaN value
-    {
-      while (it != itEnd) // find first non-nan going up from left
-      {
-        if (!qIsNaN(it->mainValue()))
-        {
-          range.lower = it->mainKey();
-          haveLower = true;
-          break;
-        }
-        ++it;
-      }
-      it = itEnd;
-      while (it != constBegin()) // find first non-nan going down from right
-      {
-        --it;
-        if (!qIsNaN(it->mainValue()))
-        {
-          range.upper = it->mainKey();
-          haveUpper = true;
-          break;
-        }
-      }
-    } else // DataType is not sorted by main key, go through all data points and accordingly expand range
-    {
-      while (it != itEnd)
-      {
-        if (!qIsNaN(it->mainValue()))
-        {
-          current = it->mainKey();
-          if (current < range.lower || !haveLower)
-          {
-            range.lower = current;
-            haveLower = true;
-          }
-          if (current > range.upper || !haveUpper)
-          {
-            range.upper = current;
-            haveUpper = true;
-          }
-        }
-        ++it;
-      }
-    }
-  } else if (signDomain == QCP::sdNegative) // range may only be in the negative sign domain
+  if (signDomain == QCP::sdNegative) // range may only be in the negative sign domain
+    itEnd = findBegin(0, false);
+  else if (signDomain == QCP::sdPositive) // range may only be in the positive sign domain
+    itBegin = findEnd(0, false);
+  
+  QCPDataContainer<DataType>::const_iterator it = itBegin;
+  while (it != itEnd) // find first non-nan going up from left
   {
-    while (it != itEnd)
+    if (!qIsNaN(it->mainValue()))
     {
-      if (!qIsNaN(it->mainValue()))
-      {
-        current = it->mainKey();
-        if ((current < range.lower || !haveLower) && current < 0)
-        {
-          range.lower = current;
-          haveLower = true;
-        }
-        if ((current > range.upper || !haveUpper) && current < 0)
-        {
-          range.upper = current;
-          haveUpper = true;
-        }
-      }
-      ++it;
+      range.lower = it->mainKey();
+      haveLower = true;
+      break;
     }
-  } else if (signDomain == QCP::sdPositive) // range may only be in the positive sign domain
+    ++it;
+  }
+  it = itEnd;
+  while (it != itBegin) // find first non-nan going down from right
   {
-    while (it != itEnd)
+    --it;
+    if (!qIsNaN(it->mainValue()))
     {
-      if (!qIsNaN(it->mainValue()))
-      {
-        current = it->mainKey();
-        if ((current < range.lower || !haveLower) && current > 0)
-        {
-          range.lower = current;
-          haveLower = true;
-        }
-        if ((current > range.upper || !haveUpper) && current > 0)
-        {
-          range.upper = current;
-          haveUpper = true;
-        }
-      }
-      ++it;
+      range.upper = it->mainKey();
+      haveUpper = true;
+      break;
     }
   }
   
@@ -3077,6 +3233,13 @@ QCPRange QCPDataContainer<DataType>::keyRange(bool &foundRange, QCP::SignDomain
   relevant e.g. for logarithmic plots which can mathematically only display one sign domain at a
   time.
 
+  If \a inKeyRange is not set, the value range is not calculated by scanning the data. Instead, the
+  container maintains the bounds of each sign domain incrementally: Adding data only expands them,
+  and removing data from the front (see \ref removeBefore, \ref setRingCapacity) is handled by a
+  sliding window. Only other removals and modifications through the non-const iterators cause a
+  single full rescan on the next call. This keeps \ref QCustomPlot::rescaleAxes cheap even with
+  many large plottables.
+
   \see keyRange
 */
 template <class DataType>
@@ -3087,8 +3250,13 @@ QCPRange QCPDataContainer<DataType>::valueRange(bool &foundRange, QCP::SignDomai
     foundRange = false;
     return QCPRange();
   }
-  QCPRange range;
   const bool restrictKeyRange = inKeyRange != QCPRange();
+  if (!restrictKeyRange)
+  {
+    ensureBounds();
+    return mValueBounds[signDomain].range(foundRange);
+  }
+  QCPRange range;
   bool haveLower = false;
   bool haveUpper = false;
   QCPRange current;
@@ -3236,6 +3404,179 @@ void QCPDataContainer<DataType>::performAutoSqueeze()
   if (shrinkPreAllocation || shrinkPostAllocation)
     squeeze(shrinkPreAllocation, shrinkPostAllocation);
 }
+
+/*! \internal
+  
+  Assigns a new \ref revision to this container. Called by every method that modifies the data,
+  including handing out non-const iterators.
+  
+  Revisions are drawn from a counter shared by all containers of this DataType, so a revision also
+  identifies the container. This allows plottables to detect data changes even if their data
+  container was replaced (see \ref QCPLayerable::captureDrawState).
+*/
+template <class DataType>
+void QCPDataContainer<DataType>::updateRevision()
+{
+  static QAtomicInt counter;
+  mRevision = counter.fetchAndAddRelaxed(1)+1;
+}
+
+/*! \internal
+  
+  Appends the single data point \a data to the incrementally maintained bounds of all sign domains
+  (see \ref valueRange, \ref keyRange). Coordinates outside a sign domain are passed to the
+  respective window as NaN, so every window stays aligned with the data point positions.
+*/
+template <class DataType>
+void QCPDataContainer<DataType>::trackBounds(const DataType &data)
+{
+  const QCPRange value = data.valueRange();
+  mValueBounds[QCP::sdBoth].append(value.lower, value.upper);
+  mValueBounds[QCP::sdNegative].append(value.lower < 0 ? value.lower : qQNaN(), value.upper < 0 ? value.upper : qQNaN());
+  mValueBounds[QCP::sdPositive].append(value.lower > 0 ? value.lower : qQNaN(), value.upper > 0 ? value.upper : qQNaN());
+  if (!DataType::sortKeyIsMainKey()) // sorted main keys are handled by binary search in keyRange
+  {
+    const double key = qIsNaN(data.mainValue()) ? qQNaN() : data.mainKey();
+    mKeyBounds[QCP::sdBoth].append(key, key);
+    mKeyBounds[QCP::sdNegative].append(key < 0 ? key : qQNaN(), key < 0 ? key : qQNaN());
+    mKeyBounds[QCP::sdPositive].append(key > 0 ? key : qQNaN(), key > 0 ? key : qQNaN());
+  }
+}
+
+/*! \internal
+  
+  Rebuilds the incrementally maintained bounds from all data points, if they were invalidated.
+*/
+template <class DataType>
+void QCPDataContainer<DataType>::ensureBounds()
+{
+  if (!mBoundsValid)
+  {
+    clearBounds();
+    boundsAppended(size());
+  }
+}
+
+/*! \internal
+  
+  Resets the incrementally maintained bounds to the valid state of an empty container.
+*/
+template <class DataType>
+void QCPDataContainer<DataType>::clearBounds()
+{
+  for (int i=0; i<3; ++i)
+  {
+    mValueBounds[i].clear();
+    mKeyBounds[i].clear();
+  }
+  mBoundsValid = true;
+  mBoundsOrdered = true;
+}
+
+/*! \internal
+  
+  Feeds the last \a count data points to the incrementally maintained bounds. Called by methods
+  that append data at the end of the container.
+*/
+template <class DataType>
+void QCPDataContainer<DataType>::boundsAppended(int count)
+{
+  if (!mBoundsValid)
+    return;
+  
+  for (QCPDataContainer<DataType>::const_iterator it = constEnd()-qMin(count, size()); it != constEnd(); ++it)
+    trackBounds(*it);
+  if (!mBoundsOrdered)
+    boundsInserted(constEnd(), constEnd()); // collapses the windows again
+}
+
+/*! \internal
+  
+  Expands the incrementally maintained bounds by the data points from \a begin to \a end, which
+  were added somewhere other than the end of the container (prepended or merged).
+  
+  The windows can then no longer follow removals from the front, because their order doesn't match
+  the data anymore. They are collapsed to a single entry holding the current bounds, which stay
+  exact under further additions. A removal invalidates them (see \ref boundsRemovedFirst).
+*/
+template <class DataType>
+void QCPDataContainer<DataType>::boundsInserted(const_iterator begin, const_iterator end)
+{
+  if (!mBoundsValid)
+    return;
+  
+  mBoundsOrdered = false;
+  for (const_iterator it = begin; it != end; ++it)
+    trackBounds(*it);
+  for (int i=0; i<3; ++i)
+  {
+    mValueBounds[i].collapse();
+    mKeyBounds[i].collapse();
+  }
+}
+
+/*! \internal
+  
+  Removes the first \a count data points from the incrementally maintained bounds. Called by
+  methods that remove data from the beginning of the container.
+*/
+template <class DataType>
+void QCPDataContainer<DataType>::boundsRemovedFirst(int count)
+{
+  if (!mBoundsValid || count <= 0)
+    return;
+  
+  if (mBoundsOrdered)
+  {
+    for (int i=0; i<3; ++i)
+    {
+      mValueBounds[i].removeFirst(count);
+      mKeyBounds[i].removeFirst(count);
+    }
+  } else
+    invalidateBounds();
+}
+
+/*! \internal
+  
+  Marks the incrementally maintained bounds as invalid. Called by any removal that isn't from the
+  front, by \ref sort and when handing out non-const iterators. The next unrestricted \ref
+  valueRange or \ref keyRange call rebuilds the bounds with a single scan.
+*/
+template <class DataType>
+void QCPDataContainer<DataType>::invalidateBounds()
+{
+  if (mBoundsValid)
+  {
+    for (int i=0; i<3; ++i)
+    {
+      mValueBounds[i].clear();
+      mKeyBounds[i].clear();
+    }
+    mBoundsValid = false;
+  }
+}
+
+/*! \internal
+  
+  If a ring capacity is set (\ref setRingCapacity) and exceeded, drops the data points with the
+  smallest sort keys by moving them to the preallocation pool. Once the pool grows larger than the
+  ring capacity, it is released with a single compacting copy, so the cost per appended point stays
+  constant.
+*/
+template <class DataType>
+void QCPDataContainer<DataType>::enforceRingCapacity()
+{
+  if (mRingCapacity <= 0 || size() <= mRingCapacity)
+    return;
+  
+  const int excess = size()-mRingCapacity;
+  updateRevision();
+  mPreallocSize += excess;
+  boundsRemovedFirst(excess);
+  if (mPreallocSize > mRingCapacity)
+    squeeze(true, false);
+}
 /* end of 'src/datacontainer.cpp' */
 
 
@@ -3272,6 +3613,7 @@ public:
   // introduced virtual methods:
   virtual void copyFrom(const QCPSelectionDecorator *other);
   virtual void drawDecoration(QCPPainter *painter, QCPDataSelection selection);
+  virtual bool captureDrawState(QDataStream &stream) const;
   
 protected:
   // property members:
@@ -3386,6 +3728,7 @@ protected:
   // non-virtual methods:
   void applyFillAntialiasingHint(QCPPainter *painter) const;
   void applyScattersAntialiasingHint(QCPPainter *painter) const;
+  bool capturePlottableState(QDataStream &stream) const;
 
 private:
   Q_DISABLE_COPY(QCPAbstractPlottable)
@@ -3787,6 +4130,7 @@ protected:
   
   // non-property members:
   QList<QSharedPointer<QCPAbstractPaintBuffer> > mPaintBuffers;
+  QByteArray mPaintBufferSetup;
   QPoint mMousePressPos;
   bool mMouseHasMoved;
   QPointer<QCPLayerable> mMouseEventLayerable;
@@ -3833,6 +4177,8 @@ protected:
   QList<QCPLayerable*> layerableListAt(const QPointF &pos, bool onlySelectable, QList<QVariant> *selectionDetails=0) const;
   void drawBackground(QCPPainter *painter);
   void setupPaintBuffers();
+  void prepareGraphLines(const QList<QCPGraph*> &graphs);
+  void drawChangedLayers();
   QCPAbstractPaintBuffer *createPaintBuffer();
   bool hasInvalidatedPaintBuffers();
   bool setupOpenGl();
@@ -3900,10 +4246,12 @@ public:
 protected:
   // property members:
   QSharedPointer<QCPDataContainer<DataType> > mDataContainer;
+  QSharedPointer<QCPDataColumns> mDataColumns;
   
   // helpers for subclasses:
   void getDataSegments(QList<QCPDataRange> &selectedSegments, QList<QCPDataRange> &unselectedSegments) const;
   void drawPolyline(QCPPainter *painter, const QVector<QPointF> &lineData) const;
+  void getDataPoint(int index, double &key, double &value) const;
 
 private:
   Q_DISABLE_COPY(QCPAbstractPlottable1D)
@@ -4073,6 +4421,12 @@ private:
   implement the according virtual methods of the \ref QCPPlottableInterface1D, such that most
   subclassed plottables don't need to worry about this anymore.
 
+  Plottables whose data points consist of just a key and a value (\ref QCPGraph, \ref QCPCurve)
+  may alternatively hold their data in \a mDataColumns (a shared pointer to \ref QCPDataColumns).
+  If it is set, the 1D interface is answered from the columns, and \a mDataContainer is left
+  empty. For plottables whose sort key isn't the main key, the sort key of a column point is its
+  index. Subclasses can read a point independently of the storage via \ref getDataPoint.
+
   Further, it provides a convenience method for retrieving selected/unselected data segments via
   \ref getDataSegments. This is useful when subclasses implement their \ref draw method and need to
   draw selected segments with a different pen/brush than unselected segments (also see \ref
@@ -4118,7 +4472,7 @@ QCPAbstractPlottable1D<DataType>::~QCPAbstractPlottable1D()
 template <class DataType>
 int QCPAbstractPlottable1D<DataType>::dataCount() const
 {
-  return mDataContainer->size();
+  return mDataColumns ? mDataColumns->size() : mDataContainer->size();
 }
 
 /*!
@@ -4127,9 +4481,12 @@ int QCPAbstractPlottable1D<DataType>::dataCount() const
 template <class DataType>
 double QCPAbstractPlottable1D<DataType>::dataMainKey(int index) const
 {
-  if (index >= 0 && index < mDataContainer->size())
+  if (index >= 0 && index < dataCount())
   {
-    return (mDataContainer->constBegin()+index)->mainKey();
+    if (mDataColumns)
+      return mDataColumns->key(index);
+    else
+      return (mDataContainer->constBegin()+index)->mainKey();
   } else
   {
     qDebug() << Q_FUNC_INFO << "Index out of bounds" << index;
@@ -4143,9 +4500,12 @@ double QCPAbstractPlottable1D<DataType>::dataMainKey(int index) const
 template <class DataType>
 double QCPAbstractPlottable1D<DataType>::dataSortKey(int index) const
 {
-  if (index >= 0 && index < mDataContainer->size())
+  if (index >= 0 && index < dataCount())
   {
-    return (mDataContainer->constBegin()+index)->sortKey();
+    if (mDataColumns)
+      return DataType::sortKeyIsMainKey() ? mDataColumns->key(index) : double(index);
+    else
+      return (mDataContainer->constBegin()+index)->sortKey();
   } else
   {
     qDebug() << Q_FUNC_INFO << "Index out of bounds" << index;
@@ -4159,9 +4519,12 @@ double QCPAbstractPlottable1D<DataType>::dataSortKey(int index) const
 template <class DataType>
 double QCPAbstractPlottable1D<DataType>::dataMainValue(int index) const
 {
-  if (index >= 0 && index < mDataContainer->size())
+  if (index >= 0 && index < dataCount())
   {
-    return (mDataContainer->constBegin()+index)->mainValue();
+    if (mDataColumns)
+      return mDataColumns->value(index);
+    else
+      return (mDataContainer->constBegin()+index)->mainValue();
   } else
   {
     qDebug() << Q_FUNC_INFO << "Index out of bounds" << index;
@@ -4175,9 +4538,12 @@ double QCPAbstractPlottable1D<DataType>::dataMainValue(int index) const
 template <class DataType>
 QCPRange QCPAbstractPlottable1D<DataType>::dataValueRange(int index) const
 {
-  if (index >= 0 && index < mDataContainer->size())
+  if (index >= 0 && index < dataCount())
   {
-    return (mDataContainer->constBegin()+index)->valueRange();
+    if (mDataColumns)
+      return QCPRange(mDataColumns->value(index), mDataColumns->value(index));
+    else
+      return (mDataContainer->constBegin()+index)->valueRange();
   } else
   {
     qDebug() << Q_FUNC_INFO << "Index out of bounds" << index;
@@ -4191,10 +4557,11 @@ QCPRange QCPAbstractPlottable1D<DataType>::dataValueRange(int index) const
 template <class DataType>
 QPointF QCPAbstractPlottable1D<DataType>::dataPixelPosition(int index) const
 {
-  if (index >= 0 && index < mDataContainer->size())
+  if (index >= 0 && index < dataCount())
   {
-    const typename QCPDataContainer<DataType>::const_iterator it = mDataContainer->constBegin()+index;
-    return coordsToPixels(it->mainKey(), it->mainValue());
+    double key, value;
+    getDataPoint(index, key, value);
+    return coordsToPixels(key, value);
   } else
   {
     qDebug() << Q_FUNC_INFO << "Index out of bounds" << index;
@@ -4222,7 +4589,7 @@ template <class DataType>
 QCPDataSelection QCPAbstractPlottable1D<DataType>::selectTestRect(const QRectF &rect, bool onlySelectable) const
 {
   QCPDataSelection result;
-  if ((onlySelectable && mSelectable == QCP::stNone) || mDataContainer->isEmpty())
+  if ((onlySelectable && mSelectable == QCP::stNone) || dataCount() == 0)
     return result;
   if (!mKeyAxis || !mValueAxis)
     return result;
@@ -4233,32 +4600,34 @@ QCPDataSelection QCPAbstractPlottable1D<DataType>::selectTestRect(const QRectF &
   pixelsToCoords(rect.bottomRight(), key2, value2);
   QCPRange keyRange(key1, key2); // QCPRange normalizes internally so we don't have to care about whether key1 < key2
   QCPRange valueRange(value1, value2);
-  typename QCPDataContainer<DataType>::const_iterator begin = mDataContainer->constBegin();
-  typename QCPDataContainer<DataType>::const_iterator end = mDataContainer->constEnd();
+  int begin = 0;
+  int end = dataCount();
   if (DataType::sortKeyIsMainKey()) // we can assume that data is sorted by main key, so can reduce the searched key interval:
   {
-    begin = mDataContainer->findBegin(keyRange.lower, false);
-    end = mDataContainer->findEnd(keyRange.upper, false);
+    begin = QCPAbstractPlottable1D<DataType>::findBegin(keyRange.lower, false);
+    end = QCPAbstractPlottable1D<DataType>::findEnd(keyRange.upper, false);
   }
   if (begin == end)
     return result;
   
   int currentSegmentBegin = -1; // -1 means we're currently not in a segment that's contained in rect
-  for (typename QCPDataContainer<DataType>::const_iterator it=begin; it!=end; ++it)
+  for (int i=begin; i<end; ++i)
   {
+    double key, value;
+    getDataPoint(i, key, value);
     if (currentSegmentBegin == -1)
     {
-      if (valueRange.contains(it->mainValue()) && keyRange.contains(it->mainKey())) // start segment
-        currentSegmentBegin = it-mDataContainer->constBegin();
-    } else if (!valueRange.contains(it->mainValue()) || !keyRange.contains(it->mainKey())) // segment just ended
+      if (valueRange.contains(value) && keyRange.contains(key)) // start segment
+        currentSegmentBegin = i;
+    } else if (!valueRange.contains(value) || !keyRange.contains(key)) // segment just ended
     {
-      result.addDataRange(QCPDataRange(currentSegmentBegin, it-mDataContainer->constBegin()), false);
+      result.addDataRange(QCPDataRange(currentSegmentBegin, i), false);
       currentSegmentBegin = -1;
     }
   }
   // process potential last segment:
   if (currentSegmentBegin != -1)
-    result.addDataRange(QCPDataRange(currentSegmentBegin, end-mDataContainer->constBegin()), false);
+    result.addDataRange(QCPDataRange(currentSegmentBegin, end), false);
   
   result.simplify();
   return result;
@@ -4270,6 +4639,16 @@ QCPDataSelection QCPAbstractPlottable1D<DataType>::selectTestRect(const QRectF &
 template <class DataType>
 int QCPAbstractPlottable1D<DataType>::findBegin(double sortKey, bool expandedRange) const
 {
+  if (mDataColumns)
+  {
+    if (DataType::sortKeyIsMainKey())
+      return mDataColumns->findBegin(sortKey, expandedRange);
+    // the sort key of a column point is its index, so the first index not below sortKey is its ceiling:
+    int index = int(qBound(0.0, std::ceil(sortKey), double(mDataColumns->size())));
+    if (expandedRange && index > 0)
+      --index;
+    return index;
+  }
   return mDataContainer->findBegin(sortKey, expandedRange)-mDataContainer->constBegin();
 }
 
@@ -4279,6 +4658,16 @@ int QCPAbstractPlottable1D<DataType>::findBegin(double sortKey, bool expandedRan
 template <class DataType>
 int QCPAbstractPlottable1D<DataType>::findEnd(double sortKey, bool expandedRange) const
 {
+  if (mDataColumns)
+  {
+    if (DataType::sortKeyIsMainKey())
+      return mDataColumns->findEnd(sortKey, expandedRange);
+    // the sort key of a column point is its index, so the first index above sortKey is its floor plus one:
+    int index = int(qBound(0.0, std::floor(sortKey)+1, double(mDataColumns->size())));
+    if (expandedRange && index < mDataColumns->size())
+      ++index;
+    return index;
+  }
   return mDataContainer->findEnd(sortKey, expandedRange)-mDataContainer->constBegin();
 }
 
@@ -4295,17 +4684,17 @@ int QCPAbstractPlottable1D<DataType>::findEnd(double sortKey, bool expandedRange
 template <class DataType>
 double QCPAbstractPlottable1D<DataType>::selectTest(const QPointF &pos, bool onlySelectable, QVariant *details) const
 {
-  if ((onlySelectable && mSelectable == QCP::stNone) || mDataContainer->isEmpty())
+  if ((onlySelectable && mSelectable == QCP::stNone) || dataCount() == 0)
     return -1;
   if (!mKeyAxis || !mValueAxis)
     return -1;
   
   QCPDataSelection selectionResult;
   double minDistSqr = (std::numeric_limits<double>::max)();
-  int minDistIndex = mDataContainer->size();
+  int minDistIndex = dataCount();
   
-  typename QCPDataContainer<DataType>::const_iterator begin = mDataContainer->constBegin();
-  typename QCPDataContainer<DataType>::const_iterator end = mDataContainer->constEnd();
+  int begin = 0;
+  int end = dataCount();
   if (DataType::sortKeyIsMainKey()) // we can assume that data is sorted by main key, so can reduce the searched key interval:
   {
     // determine which key range comes into question, taking selection tolerance around pos into account:
@@ -4314,28 +4703,28 @@ double QCPAbstractPlottable1D<DataType>::selectTest(const QPointF &pos, bool onl
     pixelsToCoords(pos+QPointF(mParentPlot->selectionTolerance(), mParentPlot->selectionTolerance()), posKeyMax, dummy);
     if (posKeyMin > posKeyMax)
       qSwap(posKeyMin, posKeyMax);
-    begin = mDataContainer->findBegin(posKeyMin, true);
-    end = mDataContainer->findEnd(posKeyMax, true);
+    begin = QCPAbstractPlottable1D<DataType>::findBegin(posKeyMin, true);
+    end = QCPAbstractPlottable1D<DataType>::findEnd(posKeyMax, true);
   }
   if (begin == end)
     return -1;
   QCPRange keyRange(mKeyAxis->range());
   QCPRange valueRange(mValueAxis->range());
-  for (typename QCPDataContainer<DataType>::const_iterator it=begin; it!=end; ++it)
+  for (int i=begin; i<end; ++i)
   {
-    const double mainKey = it->mainKey();
-    const double mainValue = it->mainValue();
+    double mainKey, mainValue;
+    getDataPoint(i, mainKey, mainValue);
     if (keyRange.contains(mainKey) && valueRange.contains(mainValue)) // make sure data point is inside visible range, for speedup in cases where sort key isn't main key and we iterate over all points
     {
       const double currentDistSqr = QCPVector2D(coordsToPixels(mainKey, mainValue)-pos).lengthSquared();
       if (currentDistSqr < minDistSqr)
       {
         minDistSqr = currentDistSqr;
-        minDistIndex = it-mDataContainer->constBegin();
+        minDistIndex = i;
       }
     }
   }
-  if (minDistIndex != mDataContainer->size())
+  if (minDistIndex != dataCount())
     selectionResult.addDataRange(QCPDataRange(minDistIndex, minDistIndex+1), false);
   
   selectionResult.simplify();
@@ -4429,6 +4818,29 @@ void QCPAbstractPlottable1D<DataType>::drawPolyline(QCPPainter *painter, const Q
     painter->drawPolyline(lineData.constData()+segmentStart, lineDataSize-segmentStart);
   }
 }
+
+/*!
+  A helper method which returns the main key and main value of the data point at \a index via \a
+  key and \a value, reading either \a mDataColumns or \a mDataContainer, whichever holds the data.
+  The index must be valid, i.e. between 0 and \ref dataCount.
+
+  Subclasses that support \ref QCPDataColumns can use this in loops that only need the key and
+  value of each point, instead of branching on the storage themselves.
+*/
+template <class DataType>
+void QCPAbstractPlottable1D<DataType>::getDataPoint(int index, double &key, double &value) const
+{
+  if (mDataColumns)
+  {
+    key = mDataColumns->key(index);
+    value = mDataColumns->value(index);
+  } else
+  {
+    const typename QCPDataContainer<DataType>::const_iterator it = mDataContainer->constBegin()+index;
+    key = it->mainKey();
+    value = it->mainValue();
+  }
+}
 /* end of 'src/plottable1d.cpp' */
 
 
@@ -4496,6 +4908,7 @@ public:
   void loadPreset(GradientPreset preset);
   void clearColorStops();
   QCPColorGradient inverted() const;
+  void captureDrawState(QDataStream &stream) const;
   
 protected:
   // property members:
@@ -4511,6 +4924,7 @@ protected:
   // non-virtual methods:
   bool stopsUseAlpha() const;
   void updateColorBuffer();
+  void mapToIndices(const double *data, const QCPRange &range, int *indices, int n, int dataIndexFactor, bool logarithmic) const;
 };
 Q_DECLARE_METATYPE(QCPColorGradient::ColorInterpolation)
 Q_DECLARE_METATYPE(QCPColorGradient::GradientPreset)
@@ -4566,6 +4980,7 @@ public:
   
   // virtual methods:
   virtual void drawDecoration(QCPPainter *painter, QCPDataSelection selection) Q_DECL_OVERRIDE;
+  virtual bool captureDrawState(QDataStream &stream) const Q_DECL_OVERRIDE;
   
 protected:
   // property members:
@@ -4691,6 +5106,7 @@ protected:
   // reimplemented virtual methods:
   virtual void applyDefaultAntialiasingHint(QCPPainter *painter) const Q_DECL_OVERRIDE;
   virtual void draw(QCPPainter *painter) Q_DECL_OVERRIDE;
+  virtual bool captureDrawState(QDataStream &stream) const Q_DECL_OVERRIDE;
   virtual int calculateAutoMargin(QCP::MarginSide side) Q_DECL_OVERRIDE;
   virtual void layoutChanged() Q_DECL_OVERRIDE;
   // events:
@@ -4911,6 +5327,7 @@ protected:
   virtual QCP::Interaction selectionCategory() const Q_DECL_OVERRIDE;
   virtual void applyDefaultAntialiasingHint(QCPPainter *painter) const Q_DECL_OVERRIDE;
   virtual void draw(QCPPainter *painter) Q_DECL_OVERRIDE;
+  virtual bool captureDrawState(QDataStream &stream) const Q_DECL_OVERRIDE;
   // events:
   virtual void selectEvent(QMouseEvent *event, bool additive, const QVariant &details, bool *selectionStateChanged) Q_DECL_OVERRIDE;
   virtual void deselectEvent(bool *selectionStateChanged) Q_DECL_OVERRIDE;
@@ -5191,6 +5608,7 @@ public:
   
   // getters:
   QSharedPointer<QCPGraphDataContainer> data() const { return mDataContainer; }
+  QSharedPointer<QCPDataColumns> columns() const { return mDataColumns; }
   LineStyle lineStyle() const { return mLineStyle; }
   QCPScatterStyle scatterStyle() const { return mScatterStyle; }
   int scatterSkip() const { return mScatterSkip; }
@@ -5199,6 +5617,7 @@ public:
   
   // setters:
   void setData(QSharedPointer<QCPGraphDataContainer> data);
+  void setData(QSharedPointer<QCPDataColumns> columns);
   void setData(const QVector<double> &keys, const QVector<double> &values, bool alreadySorted=false);
   void setLineStyle(LineStyle ls);
   void setScatterStyle(const QCPScatterStyle &style);
@@ -5223,9 +5642,16 @@ protected:
   QPointer<QCPGraph> mChannelFillGraph;
   bool mAdaptiveSampling;
   
+  // non-property members:
+  QList<QCPDataRange> mPreparedSegments;
+  QVector<QVector<QPointF> > mPreparedLines;
+  int mPreparedUnselectedCount;
+  bool mLinesPrepared;
+  
   // reimplemented virtual methods:
   virtual void draw(QCPPainter *painter) Q_DECL_OVERRIDE;
   virtual void drawLegendIcon(QCPPainter *painter, const QRectF &rect) const Q_DECL_OVERRIDE;
+  virtual bool captureDrawState(QDataStream &stream) const Q_DECL_OVERRIDE;
   
   // introduced virtual methods:
   virtual void drawFill(QCPPainter *painter, QVector<QPointF> *lines) const;
@@ -5237,7 +5663,12 @@ protected:
   virtual void getOptimizedScatterData(QVector<QCPGraphData> *scatterData, QCPGraphDataContainer::const_iterator begin, QCPGraphDataContainer::const_iterator end) const;
   
   // non-virtual methods:
+  void prepareLines();
+  void discardPreparedLines();
   void getVisibleDataBounds(QCPGraphDataContainer::const_iterator &begin, QCPGraphDataContainer::const_iterator &end, const QCPDataRange &rangeRestriction) const;
+  void getVisibleColumnBounds(int &begin, int &end, const QCPDataRange &rangeRestriction) const;
+  void getOptimizedColumnLineData(QVector<QCPGraphData> *lineData, int begin, int end) const;
+  void getOptimizedColumnScatterData(QVector<QCPGraphData> *scatterData, int begin, int end) const;
   void getLines(QVector<QPointF> *lines, const QCPDataRange &dataRange) const;
   void getScatters(QVector<QPointF> *scatters, const QCPDataRange &dataRange) const;
   QVector<QPointF> dataToLines(const QVector<QCPGraphData> &data) const;
@@ -5255,7 +5686,7 @@ protected:
   int findIndexAboveX(const QVector<QPointF> *data, double x) const;
   int findIndexBelowY(const QVector<QPointF> *data, double y) const;
   int findIndexAboveY(const QVector<QPointF> *data, double y) const;
-  double pointDistance(const QPointF &pixelPoint, QCPGraphDataContainer::const_iterator &closestData) const;
+  double pointDistance(const QPointF &pixelPoint, int &closestIndex) const;
   
   friend class QCustomPlot;
   friend class QCPLegend;
@@ -5307,6 +5738,7 @@ class QCP_LIB_DECL QCPCurve : public QCPAbstractPlottable1D<QCPCurveData>
   Q_PROPERTY(QCPScatterStyle scatterStyle READ scatterStyle WRITE setScatterStyle)
   Q_PROPERTY(int scatterSkip READ scatterSkip WRITE setScatterSkip)
   Q_PROPERTY(LineStyle lineStyle READ lineStyle WRITE setLineStyle)
+  Q_PROPERTY(bool adaptiveSampling READ adaptiveSampling WRITE setAdaptiveSampling)
   /// \endcond
 public:
   /*!
@@ -5324,17 +5756,21 @@ public:
   
   // getters:
   QSharedPointer<QCPCurveDataContainer> data() const { return mDataContainer; }
+  QSharedPointer<QCPDataColumns> columns() const { return mDataColumns; }
   QCPScatterStyle scatterStyle() const { return mScatterStyle; }
   int scatterSkip() const { return mScatterSkip; }
   LineStyle lineStyle() const { return mLineStyle; }
+  bool adaptiveSampling() const { return mAdaptiveSampling; }
   
   // setters:
   void setData(QSharedPointer<QCPCurveDataContainer> data);
   void setData(const QVector<double> &t, const QVector<double> &keys, const QVector<double> &values, bool alreadySorted=false);
   void setData(const QVector<double> &keys, const QVector<double> &values);
+  void setData(QSharedPointer<QCPDataColumns> columns);
   void setScatterStyle(const QCPScatterStyle &style);
   void setScatterSkip(int skip);
   void setLineStyle(LineStyle style);
+  void setAdaptiveSampling(bool enabled);
   
   // non-property methods:
   void addData(const QVector<double> &t, const QVector<double> &keys, const QVector<double> &values, bool alreadySorted=false);
@@ -5352,10 +5788,12 @@ protected:
   QCPScatterStyle mScatterStyle;
   int mScatterSkip;
   LineStyle mLineStyle;
+  bool mAdaptiveSampling;
   
   // reimplemented virtual methods:
   virtual void draw(QCPPainter *painter) Q_DECL_OVERRIDE;
   virtual void drawLegendIcon(QCPPainter *painter, const QRectF &rect) const Q_DECL_OVERRIDE;
+  virtual bool captureDrawState(QDataStream &stream) const Q_DECL_OVERRIDE;
   
   // introduced virtual methods:
   virtual void drawCurveLine(QCPPainter *painter, const QVector<QPointF> &lines) const;
@@ -5370,7 +5808,7 @@ protected:
   bool mayTraverse(int prevRegion, int currentRegion) const;
   bool getTraverse(double prevKey, double prevValue, double key, double value, double keyMin, double valueMax, double keyMax, double valueMin, QPointF &crossA, QPointF &crossB) const;
   void getTraverseCornerPoints(int prevRegion, int currentRegion, double keyMin, double valueMax, double keyMax, double valueMin, QVector<QPointF> &beforeTraverse, QVector<QPointF> &afterTraverse) const;
-  double pointDistance(const QPointF &pixelPoint, QCPCurveDataContainer::const_iterator &closestData) const;
+  double pointDistance(const QPointF &pixelPoint, int &closestIndex) const;
   
   friend class QCustomPlot;
   friend class QCPLegend;
@@ -5705,6 +6143,7 @@ public:
   double data(double key, double value);
   double cell(int keyIndex, int valueIndex);
   unsigned char alpha(int keyIndex, int valueIndex);
+  int revision() const;
   
   // setters:
   void setSize(int keySize, int valueSize);
@@ -5723,6 +6162,7 @@ public:
   void clearAlpha();
   void fill(double z);
   void fillAlpha(unsigned char alpha);
+  double *scanLine(int valueIndex);
   bool isEmpty() const { return mIsEmpty; }
   void coordToCell(double key, double value, int *keyIndex, int *valueIndex) const;
   void cellToCoord(int keyIndex, int valueIndex, double *key, double *value) const;
@@ -5738,10 +6178,14 @@ protected:
   unsigned char *mAlpha;
   QCPRange mDataBounds;
   bool mDataModified;
+  mutable int mRevision;
+  mutable bool mRevisionOutdated;
   
   bool createAlpha(bool initializeOpaque=true);
   
   friend class QCPColorMap;
+  friend class QCPTiledColorMap;
+  friend class QCPContour;
 };
 
 
@@ -5813,6 +6257,173 @@ protected:
   // reimplemented virtual methods:
   virtual void draw(QCPPainter *painter) Q_DECL_OVERRIDE;
   virtual void drawLegendIcon(QCPPainter *painter, const QRectF &rect) const Q_DECL_OVERRIDE;
+  virtual bool captureDrawState(QDataStream &stream) const Q_DECL_OVERRIDE;
+  
+  friend class QCustomPlot;
+  friend class QCPLegend;
+};
+
+class QCP_LIB_DECL QCPTiledColorMapSource
+{
+public:
+  virtual ~QCPTiledColorMapSource() {}
+  
+  // introduced virtual methods:
+  virtual void fillTile(int level, QCPColorMapData *tile) const = 0;
+};
+
+
+class QCP_LIB_DECL QCPTiledColorMap : public QCPAbstractPlottable
+{
+  Q_OBJECT
+  /// \cond INCLUDE_QPROPERTIES
+  Q_PROPERTY(QCPRange dataRange READ dataRange WRITE setDataRange NOTIFY dataRangeChanged)
+  Q_PROPERTY(QCPAxis::ScaleType dataScaleType READ dataScaleType WRITE setDataScaleType NOTIFY dataScaleTypeChanged)
+  Q_PROPERTY(QCPColorGradient gradient READ gradient WRITE setGradient NOTIFY gradientChanged)
+  Q_PROPERTY(int tileSize READ tileSize WRITE setTileSize)
+  Q_PROPERTY(int cacheLimit READ cacheLimit WRITE setCacheLimit)
+  /// \endcond
+public:
+  explicit QCPTiledColorMap(QCPAxis *keyAxis, QCPAxis *valueAxis);
+  virtual ~QCPTiledColorMap();
+  
+  // getters:
+  QSharedPointer<QCPTiledColorMapSource> source() const { return mSource; }
+  int keySize() const { return mKeySize; }
+  int valueSize() const { return mValueSize; }
+  QCPRange keyRange() const { return mKeyRange; }
+  QCPRange valueRange() const { return mValueRange; }
+  int tileSize() const { return mTileSize; }
+  int cacheLimit() const { return mTileCache.maxCost()/1024; }
+  QCPRange dataRange() const { return mDataRange; }
+  QCPAxis::ScaleType dataScaleType() const { return mDataScaleType; }
+  QCPColorGradient gradient() const { return mGradient; }
+  
+  // setters:
+  void setSource(QSharedPointer<QCPTiledColorMapSource> source);
+  void setSize(int keySize, int valueSize);
+  void setRange(const QCPRange &keyRange, const QCPRange &valueRange);
+  void setTileSize(int size);
+  void setCacheLimit(int megabytes);
+  Q_SLOT void setDataRange(const QCPRange &dataRange);
+  Q_SLOT void setDataScaleType(QCPAxis::ScaleType scaleType);
+  Q_SLOT void setGradient(const QCPColorGradient &gradient);
+  
+  // non-property methods:
+  int levelCount() const;
+  void invalidateTiles();
+  void rescaleDataRange();
+  
+  // reimplemented virtual methods:
+  virtual double selectTest(const QPointF &pos, bool onlySelectable, QVariant *details=0) const Q_DECL_OVERRIDE;
+  virtual QCPRange getKeyRange(bool &foundRange, QCP::SignDomain inSignDomain=QCP::sdBoth) const Q_DECL_OVERRIDE;
+  virtual QCPRange getValueRange(bool &foundRange, QCP::SignDomain inSignDomain=QCP::sdBoth, const QCPRange &inKeyRange=QCPRange()) const Q_DECL_OVERRIDE;
+  
+signals:
+  void dataRangeChanged(const QCPRange &newRange);
+  void dataScaleTypeChanged(QCPAxis::ScaleType scaleType);
+  void gradientChanged(const QCPColorGradient &newGradient);
+  
+protected:
+  struct Tile
+  {
+    Tile(int level, int keyIndex, int valueIndex, int size, const QCPRange &keyRange, const QCPRange &valueRange) :
+      data(size, size, keyRange, valueRange), level(level), keyIndex(keyIndex), valueIndex(valueIndex), revision(0), colorRevision(-1) {}
+    QCPColorMapData data;
+    QImage image;
+    int level, keyIndex, valueIndex;
+    int revision, colorRevision;
+  };
+  
+  // property members:
+  QSharedPointer<QCPTiledColorMapSource> mSource;
+  int mKeySize, mValueSize;
+  QCPRange mKeyRange, mValueRange;
+  int mTileSize;
+  QCPRange mDataRange;
+  QCPAxis::ScaleType mDataScaleType;
+  QCPColorGradient mGradient;
+  
+  // non-property members:
+  QCache<quint64, Tile> mTileCache;
+  QList<Tile*> mPendingTiles;
+  QFutureWatcher<void> mTileWatcher;
+  int mTileRevision, mColorRevision, mCacheRevision;
+  
+  // reimplemented virtual methods:
+  virtual void draw(QCPPainter *painter) Q_DECL_OVERRIDE;
+  virtual void drawLegendIcon(QCPPainter *painter, const QRectF &rect) const Q_DECL_OVERRIDE;
+  virtual bool captureDrawState(QDataStream &stream) const Q_DECL_OVERRIDE;
+  
+  // non-virtual methods:
+  int optimalLevel() const;
+  int tileCount(int level, bool keyDimension) const;
+  int tileCost() const;
+  quint64 tileKey(int level, int keyIndex, int valueIndex) const;
+  Tile *createTile(int level, int keyIndex, int valueIndex) const;
+  Tile *topTile();
+  QRectF tilePixelRect(const Tile *tile) const;
+  static void colorizeTile(Tile *tile, QCPColorGradient &gradient, const QCPRange &dataRange, bool logarithmic, bool horizontal);
+  void drawTile(QCPPainter *painter, Tile *tile);
+  void requestTiles(const QList<QPoint> &tileIndices, int level);
+  Q_SLOT void tilesFinished();
+  
+  friend class QCustomPlot;
+  friend class QCPLegend;
+};
+
+
+class QCP_LIB_DECL QCPContour : public QCPAbstractPlottable
+{
+  Q_OBJECT
+  /// \cond INCLUDE_QPROPERTIES
+  Q_PROPERTY(QVector<double> levels READ levels WRITE setLevels)
+  Q_PROPERTY(QCPColorMap* colorMap READ colorMap WRITE setColorMap)
+  /// \endcond
+public:
+  explicit QCPContour(QCPAxis *keyAxis, QCPAxis *valueAxis);
+  virtual ~QCPContour();
+  
+  // getters:
+  QCPColorMapData *data() const;
+  QCPColorMap *colorMap() const { return mColorMap.data(); }
+  QVector<double> levels() const { return mLevels; }
+  
+  // setters:
+  void setData(QCPColorMapData *data, bool copy=false);
+  void setColorMap(QCPColorMap *colorMap);
+  void setLevels(const QVector<double> &levels);
+  
+  // non-property methods:
+  void rescaleLevels(int levelCount, bool recalculateDataBounds=false);
+  
+  // reimplemented virtual methods:
+  virtual double selectTest(const QPointF &pos, bool onlySelectable, QVariant *details=0) const Q_DECL_OVERRIDE;
+  virtual QCPRange getKeyRange(bool &foundRange, QCP::SignDomain inSignDomain=QCP::sdBoth) const Q_DECL_OVERRIDE;
+  virtual QCPRange getValueRange(bool &foundRange, QCP::SignDomain inSignDomain=QCP::sdBoth, const QCPRange &inKeyRange=QCPRange()) const Q_DECL_OVERRIDE;
+  
+protected:
+  // property members:
+  QCPColorMapData *mMapData;
+  QPointer<QCPColorMap> mColorMap;
+  QVector<double> mLevels;
+  
+  // non-property members:
+  QVector<QPointF> mSegments;
+  int mSegmentsRevision;
+  bool mSegmentsInvalidated;
+  
+  // introduced virtual methods:
+  virtual void updateSegments();
+  
+  // reimplemented virtual methods:
+  virtual void draw(QCPPainter *painter) Q_DECL_OVERRIDE;
+  virtual void drawLegendIcon(QCPPainter *painter, const QRectF &rect) const Q_DECL_OVERRIDE;
+  virtual bool captureDrawState(QDataStream &stream) const Q_DECL_OVERRIDE;
+  
+  // non-virtual methods:
+  static void extractSegments(const QCPColorMapData *data, const QVector<double> &levels, const QCPDataRange &valueRows, QVector<QPointF> *segments);
+  QVector<QPointF> segmentsToPixels() const;
   
   friend class QCustomPlot;
   friend class QCPLegend;
@@ -6082,6 +6693,74 @@ protected:
   friend class QCPLegend;
 };
 
+
+class QCP_LIB_DECL QCPVectorField : public QCPAbstractPlottable
+{
+  Q_OBJECT
+  /// \cond INCLUDE_QPROPERTIES
+  Q_PROPERTY(double lengthScale READ lengthScale WRITE setLengthScale)
+  Q_PROPERTY(double headSize READ headSize WRITE setHeadSize)
+  Q_PROPERTY(double decimationSize READ decimationSize WRITE setDecimationSize)
+  /// \endcond
+public:
+  explicit QCPVectorField(QCPAxis *keyAxis, QCPAxis *valueAxis);
+  virtual ~QCPVectorField();
+  
+  // getters:
+  int dataCount() const { return mKeys.size(); }
+  const QVector<double> &keys() const { return mKeys; }
+  const QVector<double> &values() const { return mValues; }
+  const QVector<double> &keyDirections() const { return mKeyDirections; }
+  const QVector<double> &valueDirections() const { return mValueDirections; }
+  double lengthScale() const { return mLengthScale; }
+  double headSize() const { return mHeadSize; }
+  double decimationSize() const { return mDecimationSize; }
+  
+  // setters:
+  void setData(const QVector<double> &keys, const QVector<double> &values, const QVector<double> &keyDirections, const QVector<double> &valueDirections);
+  void setLengthScale(double factor);
+  void setHeadSize(double pixels);
+  void setDecimationSize(double pixels);
+  
+  // non-property methods:
+  void addData(const QVector<double> &keys, const QVector<double> &values, const QVector<double> &keyDirections, const QVector<double> &valueDirections);
+  void addData(double key, double value, double keyDirection, double valueDirection);
+  void clearData();
+  
+  // reimplemented virtual methods:
+  virtual double selectTest(const QPointF &pos, bool onlySelectable, QVariant *details=0) const Q_DECL_OVERRIDE;
+  virtual QCPRange getKeyRange(bool &foundRange, QCP::SignDomain inSignDomain=QCP::sdBoth) const Q_DECL_OVERRIDE;
+  virtual QCPRange getValueRange(bool &foundRange, QCP::SignDomain inSignDomain=QCP::sdBoth, const QCPRange &inKeyRange=QCPRange()) const Q_DECL_OVERRIDE;
+  
+protected:
+  // property members:
+  QVector<double> mKeys, mValues, mKeyDirections, mValueDirections;
+  double mLengthScale;
+  double mHeadSize;
+  double mDecimationSize;
+  
+  // non-property members:
+  int mRevision;
+  QPixmap mHeadStamp;
+  QRgb mHeadStampColor;
+  double mHeadStampSize, mHeadStampPixelRatio;
+  
+  // reimplemented virtual methods:
+  virtual void draw(QCPPainter *painter) Q_DECL_OVERRIDE;
+  virtual void drawLegendIcon(QCPPainter *painter, const QRectF &rect) const Q_DECL_OVERRIDE;
+  virtual bool captureDrawState(QDataStream &stream) const Q_DECL_OVERRIDE;
+  
+  // non-virtual methods:
+  void updateRevision();
+  void getVectorPixels(QVector<QLineF> *vectors) const;
+  QVector<int> getVisibleVectors(const QVector<QLineF> &vectors) const;
+  QCPRange getEndRange(bool keyDimension, bool &foundRange, QCP::SignDomain inSignDomain, const QCPRange &inKeyRange) const;
+  const QPixmap &headStamp(const QColor &color);
+  
+  friend class QCustomPlot;
+  friend class QCPLegend;
+};
+
 /* end of 'src/plottables/plottable-errorbar.h' */
 
 
@@ -6169,6 +6848,7 @@ protected:
   
   // reimplemented virtual methods:
   virtual void draw(QCPPainter *painter) Q_DECL_OVERRIDE;
+  virtual bool captureDrawState(QDataStream &stream) const Q_DECL_OVERRIDE;
   
   // non-virtual methods:
   QLineF getRectClippedLine(const QCPVector2D &start, const QCPVector2D &end, const QRect &rect) const;